@@ -0,0 +1,394 @@
+/*
+ * Google Benchmark suite for biginteger.h and bn.c. `make bench` builds
+ * it; by hand, bn.c needs the bn typedef that bn.h would provide:
+ *
+ *   cc -O2 '-Dbn=struct bn_s' -c bn.c -o bn.o
+ *   c++ -O2 -std=c++11 bench/bench.cpp bn.o -o bench_bigint \
+ *       -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free \
+ *       -lbenchmark -lpthread
+ *   ./bench_bigint --benchmark_format=json --benchmark_out=bench.json
+ *
+ * Operand sizes are in 15-bit limbs and sweep by powers of 8. Linear
+ * operations go up to BENCH_MAX_LIMBS (2^20 by default, i.e. past 10^6
+ * limbs); operations that are quadratic in the current code stop at
+ * BENCH_MAX_QUADRATIC, and the gcd-bound Rational reduce/add and bn_root_to
+ * stop at BENCH_MAX_GCD. Every benchmark reports bytes/s over its operand
+ * limbs plus allocs/op and alloc_bytes/op: C++ allocations are counted by
+ * the operator new below, bn.c allocations by the --wrap'ed malloc family.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include "../biginteger.h"
+
+#ifndef BENCH_MAX_LIMBS
+#define BENCH_MAX_LIMBS (1 << 20)
+#endif
+
+#ifndef BENCH_MAX_QUADRATIC
+#define BENCH_MAX_QUADRATIC (1 << 12)
+#endif
+
+#ifndef BENCH_MAX_GCD
+#define BENCH_MAX_GCD (1 << 9)
+#endif
+
+extern "C" {
+typedef struct bn_s bn;
+bn *bn_new();
+bn *bn_init(bn const *orig);
+int bn_delete(bn *t);
+int bn_add_to(bn *t, bn const *right);
+int bn_sub_to(bn *t, bn const *right);
+int bn_mul_to(bn *t, bn const *right);
+int bn_div_to(bn *t, bn const *right);
+int bn_pow_to(bn *t, int degree);
+int bn_root_to(bn *t, int reciprocal);
+int bn_cmp(bn const *left, bn const *right);
+const char *bn_to_string(bn const *t, int radix);
+int bn_import(bn *t, size_t count, int order, size_t size, int endian, const void *op);
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *p, size_t size);
+void __real_free(void *p);
+}
+
+static size_t alloc_count = 0;
+static size_t alloc_bytes = 0;
+
+extern "C" void *__wrap_malloc(size_t size) {
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+extern "C" void *__wrap_calloc(size_t count, size_t size) {
+    alloc_count++;
+    alloc_bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+extern "C" void *__wrap_realloc(void *p, size_t size) {
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_realloc(p, size);
+}
+
+extern "C" void __wrap_free(void *p) {
+    __real_free(p);
+}
+
+void *operator new(size_t size) {
+    alloc_count++;
+    alloc_bytes += size;
+    void *p = __real_malloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    __real_free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    __real_free(p);
+}
+
+// Counts allocations made between construction and report().
+class AllocScope {
+public:
+    AllocScope() : count(alloc_count), bytes(alloc_bytes) {}
+
+    void report(benchmark::State &state, size_t limbs) {
+        state.counters["allocs/op"] = benchmark::Counter(alloc_count - count, benchmark::Counter::kAvgIterations);
+        state.counters["alloc_bytes/op"] = benchmark::Counter(alloc_bytes - bytes, benchmark::Counter::kAvgIterations);
+        state.SetBytesProcessed(state.iterations() * limbs * 2);
+    }
+
+private:
+    size_t count;
+    size_t bytes;
+};
+
+static std::vector<unsigned char> random_bytes(size_t limbs, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<unsigned char> bytes((limbs * RADIX_BITS + 7) / 8);
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = rng() & 0xff;
+    }
+    bytes[0] |= 0x80;
+    return bytes;
+}
+
+static BigInteger random_big(size_t limbs, unsigned seed) {
+    std::vector<unsigned char> bytes = random_bytes(limbs, seed);
+    BigInteger ret;
+    ret.import_bytes(bytes.size(), 1, 1, 1, bytes.data());
+    return ret;
+}
+
+static bn *random_bn(size_t limbs, unsigned seed) {
+    std::vector<unsigned char> bytes = random_bytes(limbs, seed);
+    bn *ret = bn_new();
+    bn_import(ret, bytes.size(), 1, 1, 1, bytes.data());
+    return ret;
+}
+
+static void BM_Add(benchmark::State &state) {
+    size_t n = state.range(0);
+    BigInteger a = random_big(n, 1), b = random_big(n, 2);
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a + b);
+    }
+    scope.report(state, 2 * n);
+}
+
+static void BM_Sub(benchmark::State &state) {
+    size_t n = state.range(0);
+    BigInteger a = random_big(n, 1), b = random_big(n, 2);
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a - b);
+    }
+    scope.report(state, 2 * n);
+}
+
+static void BM_Compare(benchmark::State &state) {
+    size_t n = state.range(0);
+    BigInteger a = random_big(n, 1), b = a;
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a < b);
+    }
+    scope.report(state, 2 * n);
+}
+
+static void BM_Mul(benchmark::State &state) {
+    size_t n = state.range(0);
+    BigInteger a = random_big(n, 1), b = random_big(n, 2);
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a * b);
+    }
+    scope.report(state, 2 * n);
+}
+
+static void BM_Div(benchmark::State &state) {
+    size_t n = state.range(0);
+    BigInteger a = random_big(2 * n, 1), b = random_big(n, 2);
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a / b);
+    }
+    scope.report(state, 3 * n);
+}
+
+static void BM_Mod(benchmark::State &state) {
+    size_t n = state.range(0);
+    BigInteger a = random_big(2 * n, 1), b = random_big(n, 2);
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a % b);
+    }
+    scope.report(state, 3 * n);
+}
+
+static void BM_ToString(benchmark::State &state) {
+    size_t n = state.range(0);
+    BigInteger a = random_big(n, 1);
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a.toString());
+    }
+    scope.report(state, n);
+}
+
+static void BM_Parse(benchmark::State &state) {
+    size_t n = state.range(0);
+    std::string s = random_big(n, 1).toString();
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(BigInteger(s));
+    }
+    scope.report(state, n);
+}
+
+static void BM_RationalReduce(benchmark::State &state) {
+    size_t n = state.range(0);
+    BigInteger g = random_big(n / 2 + 1, 3);
+    BigInteger a = random_big(n, 1) * g, b = random_big(n, 2) * g;
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Rational(a, b));
+    }
+    scope.report(state, 2 * n);
+}
+
+static void BM_RationalAdd(benchmark::State &state) {
+    size_t n = state.range(0);
+    Rational a(random_big(n, 1), random_big(n, 2)), b(random_big(n, 3), random_big(n, 4));
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a + b);
+    }
+    scope.report(state, 4 * n);
+}
+
+static void BM_RationalCompare(benchmark::State &state) {
+    size_t n = state.range(0);
+    Rational a(random_big(n, 1), random_big(n, 2)), b(random_big(n, 3), random_big(n, 4));
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a < b);
+    }
+    scope.report(state, 4 * n);
+}
+
+static void BM_RationalAsDecimal(benchmark::State &state) {
+    size_t n = state.range(0);
+    Rational a(random_big(n, 1), random_big(n, 2));
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a.asDecimal(100));
+    }
+    scope.report(state, 2 * n);
+}
+
+static void BM_BnAdd(benchmark::State &state) {
+    size_t n = state.range(0);
+    bn *a = random_bn(n, 1), *b = random_bn(n, 2);
+    AllocScope scope;
+    for (auto _ : state) {
+        bn *t = bn_init(a);
+        bn_add_to(t, b);
+        bn_delete(t);
+    }
+    scope.report(state, 2 * n);
+    bn_delete(a);
+    bn_delete(b);
+}
+
+static void BM_BnSub(benchmark::State &state) {
+    size_t n = state.range(0);
+    bn *a = random_bn(n, 1), *b = random_bn(n, 2);
+    AllocScope scope;
+    for (auto _ : state) {
+        bn *t = bn_init(a);
+        bn_sub_to(t, b);
+        bn_delete(t);
+    }
+    scope.report(state, 2 * n);
+    bn_delete(a);
+    bn_delete(b);
+}
+
+static void BM_BnCompare(benchmark::State &state) {
+    size_t n = state.range(0);
+    bn *a = random_bn(n, 1), *b = bn_init(a);
+    AllocScope scope;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bn_cmp(a, b));
+    }
+    scope.report(state, 2 * n);
+    bn_delete(a);
+    bn_delete(b);
+}
+
+static void BM_BnMul(benchmark::State &state) {
+    size_t n = state.range(0);
+    bn *a = random_bn(n, 1), *b = random_bn(n, 2);
+    AllocScope scope;
+    for (auto _ : state) {
+        bn *t = bn_init(a);
+        bn_mul_to(t, b);
+        bn_delete(t);
+    }
+    scope.report(state, 2 * n);
+    bn_delete(a);
+    bn_delete(b);
+}
+
+static void BM_BnDiv(benchmark::State &state) {
+    size_t n = state.range(0);
+    bn *a = random_bn(2 * n, 1), *b = random_bn(n, 2);
+    AllocScope scope;
+    for (auto _ : state) {
+        bn *t = bn_init(a);
+        bn_div_to(t, b);
+        bn_delete(t);
+    }
+    scope.report(state, 3 * n);
+    bn_delete(a);
+    bn_delete(b);
+}
+
+static void BM_BnToString(benchmark::State &state) {
+    size_t n = state.range(0);
+    bn *a = random_bn(n, 1);
+    AllocScope scope;
+    for (auto _ : state) {
+        const char *s = bn_to_string(a, 10);
+        benchmark::DoNotOptimize(s);
+        free((void*)s);
+    }
+    scope.report(state, n);
+    bn_delete(a);
+}
+
+// Base of n limbs raised to the 16th power.
+static void BM_BnPow(benchmark::State &state) {
+    size_t n = state.range(0);
+    bn *a = random_bn(n, 1);
+    AllocScope scope;
+    for (auto _ : state) {
+        bn *t = bn_init(a);
+        bn_pow_to(t, 16);
+        bn_delete(t);
+    }
+    scope.report(state, n);
+    bn_delete(a);
+}
+
+static void BM_BnRoot(benchmark::State &state) {
+    size_t n = state.range(0);
+    bn *a = random_bn(n, 1);
+    AllocScope scope;
+    for (auto _ : state) {
+        bn *t = bn_init(a);
+        bn_root_to(t, 3);
+        bn_delete(t);
+    }
+    scope.report(state, n);
+    bn_delete(a);
+}
+
+#define BENCH_LINEAR(fn) BENCHMARK(fn)->RangeMultiplier(8)->Range(1, BENCH_MAX_LIMBS)
+#define BENCH_QUADRATIC(fn) BENCHMARK(fn)->RangeMultiplier(8)->Range(1, BENCH_MAX_QUADRATIC)
+#define BENCH_GCD(fn) BENCHMARK(fn)->RangeMultiplier(8)->Range(1, BENCH_MAX_GCD)
+
+BENCH_LINEAR(BM_Add);
+BENCH_LINEAR(BM_Sub);
+BENCH_LINEAR(BM_Compare);
+BENCH_QUADRATIC(BM_Mul);
+BENCH_QUADRATIC(BM_Div);
+BENCH_QUADRATIC(BM_Mod);
+BENCH_QUADRATIC(BM_ToString);
+BENCH_QUADRATIC(BM_Parse);
+BENCH_GCD(BM_RationalReduce);
+BENCH_GCD(BM_RationalAdd);
+BENCH_QUADRATIC(BM_RationalCompare);
+BENCH_QUADRATIC(BM_RationalAsDecimal);
+BENCH_LINEAR(BM_BnAdd);
+BENCH_LINEAR(BM_BnSub);
+BENCH_LINEAR(BM_BnCompare);
+BENCH_QUADRATIC(BM_BnMul);
+BENCH_QUADRATIC(BM_BnDiv);
+BENCH_QUADRATIC(BM_BnToString);
+BENCH_QUADRATIC(BM_BnPow);
+BENCH_GCD(BM_BnRoot);
+
+BENCHMARK_MAIN();
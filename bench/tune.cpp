@@ -0,0 +1,96 @@
+// Measures the multiplication crossovers of biginteger.h on this machine.
+//
+//   c++ -O2 -std=c++11 bench/tune.cpp -o tune_bigint
+//   ./tune_bigint [bigint_thresholds.h] [bigint_thresholds.txt]
+//
+// The header defines the BIGINT_*_THRESHOLD macros; include it before
+// biginteger.h (or pass it with -include) to bake the values in. The text
+// file is the format read by BigInteger::load_thresholds at runtime.
+//
+// For each candidate size n the one-level Karatsuba split (threshold = n,
+// so the halves fall back to the basecase) is timed against the plain
+// basecase; the threshold is the smallest n at which the split wins three
+// sizes in a row.
+
+#include <chrono>
+#include <random>
+#include "../biginteger.h"
+
+static const size_t TUNE_MIN = 8;
+static const size_t TUNE_MAX = 512;
+
+static BigInteger random_big(size_t limbs, std::mt19937 &rng) {
+    std::vector<unsigned char> bytes((limbs * RADIX_BITS + 7) / 8);
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = rng() & 0xff;
+    }
+    bytes[0] |= 0x80;
+    BigInteger ret;
+    ret.import_bytes(bytes.size(), 1, 1, 1, bytes.data());
+    return ret;
+}
+
+// Best of several runs, in seconds per operation.
+static double time_op(const BigInteger &a, const BigInteger &b, bool square) {
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        size_t reps = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        do {
+            BigInteger r = a;
+            if (square) r *= r;
+            else r *= b;
+            reps++;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < 0.01);
+        best = std::min(best, elapsed / reps);
+    }
+    return best;
+}
+
+static size_t tune(size_t BigIntegerThresholds::*field, bool square) {
+    std::mt19937 rng(12345);
+    std::vector<size_t> sizes;
+    std::vector<bool> wins;
+    for (size_t n = TUNE_MIN; n <= TUNE_MAX; n += n / 4) {
+        BigInteger a = random_big(n, rng), b = random_big(n, rng);
+        BigInteger::thresholds().*field = TUNE_MAX * 4;
+        double basecase = time_op(a, b, square);
+        BigInteger::thresholds().*field = n;
+        double split = time_op(a, b, square);
+        fprintf(stderr, "%s n=%lu basecase=%.3gs karatsuba=%.3gs\n", square ? "sqr" : "mul", (unsigned long)n, basecase, split);
+        sizes.push_back(n);
+        wins.push_back(split < basecase);
+    }
+    // Require three wins in a row so a single noisy sample cannot decide.
+    for (size_t i = 0; i + 2 < sizes.size(); i++) {
+        if (wins[i] && wins[i + 1] && wins[i + 2]) return sizes[i];
+    }
+    return TUNE_MAX;
+}
+
+int main(int argc, char **argv) {
+    const char *header = argc > 1 ? argv[1] : "bigint_thresholds.h";
+    const char *table = argc > 2 ? argv[2] : "bigint_thresholds.txt";
+    BigIntegerThresholds tuned;
+    tuned.mul_karatsuba = tune(&BigIntegerThresholds::mul_karatsuba, false);
+    tuned.sqr_karatsuba = tune(&BigIntegerThresholds::sqr_karatsuba, true);
+    BigInteger::thresholds() = tuned;
+
+    FILE *f = fopen(header, "w");
+    if (f == NULL) {
+        perror(header);
+        return 1;
+    }
+    fprintf(f, "// Generated by bench/tune.cpp.\n");
+    fprintf(f, "#define BIGINT_MUL_KARATSUBA_THRESHOLD %lu\n", (unsigned long)tuned.mul_karatsuba);
+    fprintf(f, "#define BIGINT_SQR_KARATSUBA_THRESHOLD %lu\n", (unsigned long)tuned.sqr_karatsuba);
+    fclose(f);
+    if (!BigInteger::save_thresholds(table)) {
+        perror(table);
+        return 1;
+    }
+    printf("mul_karatsuba %lu\nsqr_karatsuba %lu\n", (unsigned long)tuned.mul_karatsuba, (unsigned long)tuned.sqr_karatsuba);
+    return 0;
+}
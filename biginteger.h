@@ -1,13 +1,744 @@
 #include <iostream>
 #include <vector>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <stdexcept>
+#include <cctype>
+#include <cstdio>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <exception>
+#ifdef BIGINT_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 static const std::string DIGITS = "0123456789";
 static const int RADIX = 1 << 15;
+static const int RADIX_BITS = 15;
+static const int SERIAL_VERSION = 1;
+static const int SERIAL_SIGN = 1;
+static const int SERIAL_VARINT = 2;
+static const size_t SERIAL_HEADER = 8;
+static const size_t SERIAL_ARRAY_HEADER = 16;
+// Smallest record: tag byte, one-byte varint count, one limb.
+static const size_t SERIAL_MIN_RECORD = 4;
+static const int DECIMAL_BLOCK = 1000000000;
+static const size_t DECIMAL_BLOCK_DIGITS = 9;
 std::string& reverse(std::string& s);
 
+// Default crossover points, in limbs of the smaller operand. bench/tune.cpp
+// measures them on the host and writes a header with these macros.
+#ifndef BIGINT_MUL_KARATSUBA_THRESHOLD
+#define BIGINT_MUL_KARATSUBA_THRESHOLD 40
+#endif
+
+#ifndef BIGINT_SQR_KARATSUBA_THRESHOLD
+#define BIGINT_SQR_KARATSUBA_THRESHOLD 60
+#endif
+
+struct BigIntegerThresholds {
+    size_t mul_karatsuba;
+    size_t sqr_karatsuba;
+};
+
+// Operation counters, compiled in only with -DBIGINT_STATS. Each thread
+// updates its own block without atomic read-modify-write; snapshot() sums
+// the blocks of live threads with the totals left by finished ones.
+// Counts are bucketed by floor(log2(limbs)).
+#ifdef BIGINT_STATS
+enum BigIntegerStat {
+    STAT_MUL, STAT_MUL_BASECASE, STAT_MUL_KARATSUBA, STAT_SQR_BASECASE, STAT_SQR_KARATSUBA,
+    STAT_DIV, STAT_REDUCE, STAT_GCD_STEP, STAT_ALLOC, STAT_COUNT
+};
+
+static const char *const STAT_NAMES[STAT_COUNT] = {
+    "mul", "mul_basecase", "mul_karatsuba", "sqr_basecase", "sqr_karatsuba",
+    "div", "reduce", "gcd_step", "alloc"
+};
+
+static const size_t STAT_BUCKETS = 48;
+
+struct BigIntegerStatsBlock {
+    unsigned long long count[STAT_COUNT][STAT_BUCKETS];
+    unsigned long long nanos[STAT_COUNT];
+    unsigned long long alloc_bytes;
+};
+
+class BigIntegerStats {
+public:
+    static void count(BigIntegerStat op, size_t limbs) {
+        bump(local().count[op][bucket(limbs)], 1);
+    }
+
+    static void count_time(BigIntegerStat op, size_t limbs, unsigned long long nanos) {
+        Counters &c = local();
+        bump(c.count[op][bucket(limbs)], 1);
+        bump(c.nanos[op], nanos);
+    }
+
+    static void count_alloc(size_t limbs, size_t bytes) {
+        Counters &c = local();
+        bump(c.count[STAT_ALLOC][bucket(limbs)], 1);
+        bump(c.alloc_bytes, bytes);
+    }
+
+    static BigIntegerStatsBlock snapshot() {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        BigIntegerStatsBlock ret = r.retired;
+        for (size_t i = 0; i < r.live.size(); i++) {
+            r.live[i]->add_to(ret);
+        }
+        return ret;
+    }
+
+    static void reset() {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.retired = BigIntegerStatsBlock();
+        for (size_t i = 0; i < r.live.size(); i++) {
+            r.live[i]->clear();
+        }
+    }
+
+    // {"mul": {"count": n, "nanos": t, "buckets": {"<min limbs>": n, ...}}, ...,
+    //  "alloc_bytes": b}; operations that never ran are left out.
+    static std::string to_json() {
+        return to_json(snapshot());
+    }
+
+    static std::string to_json(const BigIntegerStatsBlock &s) {
+        std::string out = "{";
+        char buf[64];
+        for (int op = 0; op < STAT_COUNT; op++) {
+            unsigned long long total = 0;
+            for (size_t b = 0; b < STAT_BUCKETS; b++) total += s.count[op][b];
+            if (total == 0) continue;
+            snprintf(buf, sizeof(buf), "\"%s\": {\"count\": %llu, \"nanos\": %llu, \"buckets\": {", STAT_NAMES[op], total, s.nanos[op]);
+            out += buf;
+            bool first = true;
+            for (size_t b = 0; b < STAT_BUCKETS; b++) {
+                if (s.count[op][b] == 0) continue;
+                snprintf(buf, sizeof(buf), "%s\"%llu\": %llu", first ? "" : ", ", b ? 1ULL << (b - 1) : 0ULL, s.count[op][b]);
+                out += buf;
+                first = false;
+            }
+            out += "}}, ";
+        }
+        snprintf(buf, sizeof(buf), "\"alloc_bytes\": %llu}", s.alloc_bytes);
+        return out + buf;
+    }
+
+private:
+    typedef std::atomic<unsigned long long> Counter;
+
+    struct Counters {
+        Counter count[STAT_COUNT][STAT_BUCKETS];
+        Counter nanos[STAT_COUNT];
+        Counter alloc_bytes;
+
+        Counters() {
+            clear();
+            Registry &r = registry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            r.live.push_back(this);
+        }
+
+        ~Counters() {
+            Registry &r = registry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            add_to(r.retired);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+        }
+
+        void clear() {
+            for (int op = 0; op < STAT_COUNT; op++) {
+                for (size_t b = 0; b < STAT_BUCKETS; b++) count[op][b].store(0, std::memory_order_relaxed);
+                nanos[op].store(0, std::memory_order_relaxed);
+            }
+            alloc_bytes.store(0, std::memory_order_relaxed);
+        }
+
+        void add_to(BigIntegerStatsBlock &s) const {
+            for (int op = 0; op < STAT_COUNT; op++) {
+                for (size_t b = 0; b < STAT_BUCKETS; b++) s.count[op][b] += count[op][b].load(std::memory_order_relaxed);
+                s.nanos[op] += nanos[op].load(std::memory_order_relaxed);
+            }
+            s.alloc_bytes += alloc_bytes.load(std::memory_order_relaxed);
+        }
+    };
+
+    struct Registry {
+        std::mutex lock;
+        std::vector<Counters*> live;
+        BigIntegerStatsBlock retired;
+
+        Registry() : retired() {}
+    };
+
+    // Only the owning thread writes, so a relaxed load and store suffice.
+    static void bump(Counter &c, unsigned long long by) {
+        c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    static size_t bucket(size_t limbs) {
+        size_t b = 0;
+        while (limbs > 0 && b + 1 < STAT_BUCKETS) {
+            limbs >>= 1;
+            b++;
+        }
+        return b;
+    }
+
+    static Registry& registry() {
+        static Registry r;
+        return r;
+    }
+
+    static Counters& local() {
+        static thread_local Counters c;
+        return c;
+    }
+};
+
+class BigIntegerStatTimer {
+public:
+    BigIntegerStatTimer(BigIntegerStat op, size_t limbs) : op(op), limbs(limbs), start(std::chrono::steady_clock::now()) {}
+
+    ~BigIntegerStatTimer() {
+        std::chrono::steady_clock::duration spent = std::chrono::steady_clock::now() - start;
+        BigIntegerStats::count_time(op, limbs, std::chrono::duration_cast<std::chrono::nanoseconds>(spent).count());
+    }
+
+private:
+    BigIntegerStat op;
+    size_t limbs;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define BIGINT_COUNT(op, limbs) BigIntegerStats::count(op, limbs)
+#define BIGINT_TIMED(op, limbs) BigIntegerStatTimer bigint_stat_timer(op, limbs)
+#else
+#define BIGINT_COUNT(op, limbs) ((void)0)
+#define BIGINT_TIMED(op, limbs) ((void)0)
+#endif
+
+// Limb storage accounting, compiled in only with -DBIGINT_MEMORY_STATS.
+// Tracks live limb buffers, live limbs and bytes, the peak, and a histogram
+// of allocation sizes per operation. The operation is set by the outermost
+// BIGINT_MEMORY_OP scope on the calling thread, so the buffers a Rational
+// product allocates through BigInteger::operator*= are charged to the
+// Rational operation.
+#ifdef BIGINT_MEMORY_STATS
+enum BigIntegerMemoryOp {
+    MEMORY_OTHER, MEMORY_ADD, MEMORY_MUL, MEMORY_DIV, MEMORY_REDUCE, MEMORY_RATIONAL,
+    MEMORY_PARSE, MEMORY_FORMAT, MEMORY_OP_COUNT
+};
+
+static const char *const MEMORY_OP_NAMES[MEMORY_OP_COUNT] = {
+    "other", "add", "mul", "div", "reduce", "rational", "parse", "format"
+};
+
+static const size_t MEMORY_BUCKETS = 48;
+
+struct BigIntegerMemoryStats {
+    unsigned long long live_buffers;
+    unsigned long long live_limbs;
+    unsigned long long live_bytes;
+    unsigned long long peak_bytes;
+    unsigned long long histogram[MEMORY_OP_COUNT][MEMORY_BUCKETS];
+};
+
+class BigIntegerMemory {
+public:
+    class Scope {
+    public:
+        explicit Scope(BigIntegerMemoryOp op) : saved(current()) {
+            if (saved == MEMORY_OTHER) current() = op;
+        }
+
+        ~Scope() {
+            current() = saved;
+        }
+
+    private:
+        BigIntegerMemoryOp saved;
+
+        Scope(const Scope &);
+        Scope& operator=(const Scope &);
+    };
+
+    static void on_alloc(size_t limbs, size_t bytes) {
+        State &s = state();
+        s.live_buffers.fetch_add(1, std::memory_order_relaxed);
+        s.live_limbs.fetch_add(limbs, std::memory_order_relaxed);
+        unsigned long long live = s.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        unsigned long long peak = s.peak_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !s.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+        s.histogram[current()][bucket(limbs)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void on_free(size_t limbs, size_t bytes) {
+        State &s = state();
+        s.live_buffers.fetch_sub(1, std::memory_order_relaxed);
+        s.live_limbs.fetch_sub(limbs, std::memory_order_relaxed);
+        s.live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    static BigIntegerMemoryStats snapshot() {
+        State &s = state();
+        BigIntegerMemoryStats ret;
+        ret.live_buffers = s.live_buffers.load(std::memory_order_relaxed);
+        ret.live_limbs = s.live_limbs.load(std::memory_order_relaxed);
+        ret.live_bytes = s.live_bytes.load(std::memory_order_relaxed);
+        ret.peak_bytes = s.peak_bytes.load(std::memory_order_relaxed);
+        for (int op = 0; op < MEMORY_OP_COUNT; op++) {
+            for (size_t b = 0; b < MEMORY_BUCKETS; b++) ret.histogram[op][b] = s.histogram[op][b].load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
+    // Restarts the peak from the current live size and clears the histogram.
+    static void reset() {
+        State &s = state();
+        s.peak_bytes.store(s.live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        for (int op = 0; op < MEMORY_OP_COUNT; op++) {
+            for (size_t b = 0; b < MEMORY_BUCKETS; b++) s.histogram[op][b].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // {"live_buffers": n, "live_limbs": n, "live_bytes": b, "peak_bytes": b,
+    //  "histogram": {"mul": {"<min limbs>": n, ...}, ...}}
+    static std::string to_json() {
+        return to_json(snapshot());
+    }
+
+    static std::string to_json(const BigIntegerMemoryStats &s) {
+        char buf[160];
+        snprintf(buf, sizeof(buf), "{\"live_buffers\": %llu, \"live_limbs\": %llu, \"live_bytes\": %llu, \"peak_bytes\": %llu, \"histogram\": {",
+                 s.live_buffers, s.live_limbs, s.live_bytes, s.peak_bytes);
+        std::string out = buf;
+        bool first_op = true;
+        for (int op = 0; op < MEMORY_OP_COUNT; op++) {
+            bool first = true;
+            for (size_t b = 0; b < MEMORY_BUCKETS; b++) {
+                if (s.histogram[op][b] == 0) continue;
+                if (first) {
+                    snprintf(buf, sizeof(buf), "%s\"%s\": {", first_op ? "" : ", ", MEMORY_OP_NAMES[op]);
+                    out += buf;
+                    first_op = false;
+                }
+                snprintf(buf, sizeof(buf), "%s\"%llu\": %llu", first ? "" : ", ", b ? 1ULL << (b - 1) : 0ULL, s.histogram[op][b]);
+                out += buf;
+                first = false;
+            }
+            if (!first) out += "}";
+        }
+        return out + "}}";
+    }
+
+private:
+    typedef std::atomic<unsigned long long> Counter;
+
+    struct State {
+        Counter live_buffers;
+        Counter live_limbs;
+        Counter live_bytes;
+        Counter peak_bytes;
+        Counter histogram[MEMORY_OP_COUNT][MEMORY_BUCKETS];
+
+        State() : live_buffers(0), live_limbs(0), live_bytes(0), peak_bytes(0) {
+            for (int op = 0; op < MEMORY_OP_COUNT; op++) {
+                for (size_t b = 0; b < MEMORY_BUCKETS; b++) histogram[op][b].store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    static size_t bucket(size_t limbs) {
+        size_t b = 0;
+        while (limbs > 0 && b + 1 < MEMORY_BUCKETS) {
+            limbs >>= 1;
+            b++;
+        }
+        return b;
+    }
+
+    static State& state() {
+        static State s;
+        return s;
+    }
+
+    static BigIntegerMemoryOp& current() {
+        static thread_local BigIntegerMemoryOp op = MEMORY_OTHER;
+        return op;
+    }
+};
+
+#define BIGINT_MEMORY_OP(op) BigIntegerMemory::Scope bigint_memory_scope(op)
+#else
+#define BIGINT_MEMORY_OP(op) ((void)0)
+#endif
+
+// Limb storage allocator that reports every allocation to the counters.
+#if defined(BIGINT_STATS) || defined(BIGINT_MEMORY_STATS)
+template <typename T>
+struct LimbAllocator {
+    typedef T value_type;
+
+    LimbAllocator() {}
+
+    template <typename U>
+    LimbAllocator(const LimbAllocator<U> &) {}
+
+    T* allocate(size_t n) {
+#ifdef BIGINT_STATS
+        BigIntegerStats::count_alloc(n, n * sizeof(T));
+#endif
+        T *p = std::allocator<T>().allocate(n);
+#ifdef BIGINT_MEMORY_STATS
+        BigIntegerMemory::on_alloc(n, n * sizeof(T));
+#endif
+        return p;
+    }
+
+    void deallocate(T *p, size_t n) {
+#ifdef BIGINT_MEMORY_STATS
+        BigIntegerMemory::on_free(n, n * sizeof(T));
+#endif
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const LimbAllocator<T> &, const LimbAllocator<U> &) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const LimbAllocator<T> &, const LimbAllocator<U> &) {
+    return false;
+}
+
+typedef std::vector<int, LimbAllocator<int> > LimbBuffer;
+#else
+typedef std::vector<int> LimbBuffer;
+#endif
+
+// Limbs kept inside BigInteger itself; the default covers every value
+// below 2^75, so all 64-bit integers are stored without a heap buffer.
+#ifndef BIGINT_INLINE_LIMBS
+#define BIGINT_INLINE_LIMBS 5
+#endif
+
+// Limb vector with room for N limbs inside the object. Longer values move
+// to a buffer from Alloc, which stays in use when the value shrinks again
+// until shrink_to_fit. Provides the subset of std::vector that BigInteger
+// uses. Unlike std::vector, moving or swapping a vector whose limbs are
+// inline copies them, so pointers into it do not survive.
+template <size_t N, typename Alloc>
+class InlineLimbVector {
+public:
+    typedef int value_type;
+    typedef int* iterator;
+    typedef const int* const_iterator;
+
+    InlineLimbVector() : ptr(local), count(0), cap(N) {}
+
+    explicit InlineLimbVector(size_t n, int value = 0) : ptr(local), count(0), cap(N) {
+        assign(n, value);
+    }
+
+    InlineLimbVector(const InlineLimbVector &b) : ptr(local), count(0), cap(N) {
+        assign(b.begin(), b.end());
+    }
+
+    InlineLimbVector(InlineLimbVector &&b) noexcept : ptr(local), count(0), cap(N) {
+        take(b);
+    }
+
+    ~InlineLimbVector() {
+        release();
+    }
+
+    InlineLimbVector& operator=(const InlineLimbVector &b) {
+        if (this != &b) assign(b.begin(), b.end());
+        return *this;
+    }
+
+    InlineLimbVector& operator=(InlineLimbVector &&b) noexcept {
+        if (this != &b) {
+            release();
+            ptr = local;
+            cap = N;
+            take(b);
+        }
+        return *this;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    size_t capacity() const {
+        return cap;
+    }
+
+    size_t max_size() const {
+        return std::allocator_traits<Alloc>::max_size(Alloc());
+    }
+
+    int* data() {
+        return ptr;
+    }
+
+    const int* data() const {
+        return ptr;
+    }
+
+    int* begin() {
+        return ptr;
+    }
+
+    const int* begin() const {
+        return ptr;
+    }
+
+    int* end() {
+        return ptr + count;
+    }
+
+    const int* end() const {
+        return ptr + count;
+    }
+
+    int& operator[](size_t i) {
+        return ptr[i];
+    }
+
+    const int& operator[](size_t i) const {
+        return ptr[i];
+    }
+
+    int& back() {
+        return ptr[count - 1];
+    }
+
+    const int& back() const {
+        return ptr[count - 1];
+    }
+
+    void reserve(size_t n) {
+        if (n > cap) reallocate(n);
+    }
+
+    void resize(size_t n, int value = 0) {
+        if (n > cap) reallocate(n > 2 * cap ? n : 2 * cap);
+        for (size_t i = count; i < n; i++) ptr[i] = value;
+        count = n;
+    }
+
+    void assign(size_t n, int value) {
+        count = 0;
+        resize(n, value);
+    }
+
+    // [first, last) may lie inside this vector.
+    template <typename It>
+    typename std::enable_if<!std::is_integral<It>::value>::type assign(It first, It last) {
+        size_t n = std::distance(first, last);
+        if (n > cap) {
+            int *p = Alloc().allocate(n);
+            std::copy(first, last, p);
+            release();
+            ptr = p;
+            cap = n;
+        }
+        else {
+            std::copy(first, last, ptr);
+        }
+        count = n;
+    }
+
+    void push_back(int value) {
+        if (count == cap) reallocate(2 * cap);
+        ptr[count++] = value;
+    }
+
+    void pop_back() {
+        count--;
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+    int* insert(int *pos, size_t n, int value) {
+        size_t at = pos - ptr;
+        resize(count + n);
+        std::copy_backward(ptr + at, ptr + count - n, ptr + count);
+        std::fill(ptr + at, ptr + at + n, value);
+        return ptr + at;
+    }
+
+    void swap(InlineLimbVector &b) {
+        if (ptr != local && b.ptr != local) {
+            std::swap(ptr, b.ptr);
+            std::swap(count, b.count);
+            std::swap(cap, b.cap);
+            return;
+        }
+        InlineLimbVector tmp(std::move(b));
+        b = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    void shrink_to_fit() {
+        if (ptr != local && count < cap) InlineLimbVector(*this).swap(*this);
+    }
+
+private:
+    int *ptr;
+    size_t count;
+    size_t cap;
+    int local[N];
+
+    void reallocate(size_t n) {
+        int *p = Alloc().allocate(n);
+        std::copy(ptr, ptr + count, p);
+        release();
+        ptr = p;
+        cap = n;
+    }
+
+    void release() {
+        if (ptr != local) Alloc().deallocate(ptr, cap);
+    }
+
+    // Leaves b empty and inline.
+    void take(InlineLimbVector &b) {
+        if (b.ptr == b.local) {
+            std::copy(b.local, b.local + b.count, local);
+        }
+        else {
+            ptr = b.ptr;
+            cap = b.cap;
+            b.ptr = b.local;
+            b.cap = N;
+        }
+        count = b.count;
+        b.count = 0;
+    }
+};
+
+typedef InlineLimbVector<BIGINT_INLINE_LIMBS, LimbBuffer::allocator_type> LimbVector;
+
+// Scratch limbs for BigInteger::mul, div and gcd. Buffers are taken
+// stack-wise through a Frame and kept when the frame ends, so a loop that
+// hands the same workspace to every call stops allocating once it has seen
+// its largest operands. Not shareable between threads.
+class BigIntegerWorkspace {
+public:
+    BigIntegerWorkspace() : top(0) {}
+
+    class Frame {
+    public:
+        explicit Frame(BigIntegerWorkspace &ws) : ws(ws), mark(ws.top) {}
+
+        ~Frame() {
+            ws.top = mark;
+        }
+
+        // Valid until the frame ends; the contents are unspecified.
+        int* take(size_t limbs) {
+            return ws.take(limbs);
+        }
+
+    private:
+        BigIntegerWorkspace &ws;
+        size_t mark;
+
+        Frame(const Frame &);
+        Frame& operator=(const Frame &);
+    };
+
+    // Limbs held across all buffers.
+    size_t capacity() const {
+        size_t total = 0;
+        for (size_t i = 0; i < buffers.size(); i++) {
+            total += buffers[i].capacity();
+        }
+        return total;
+    }
+
+    int clear() {
+        std::vector<LimbBuffer>().swap(buffers);
+        top = 0;
+        return 0;
+    }
+
+private:
+    // Moving a LimbBuffer keeps its storage, so pointers handed out stay
+    // valid when buffers itself grows. A LimbVector would not: its inline
+    // limbs move with it.
+    std::vector<LimbBuffer> buffers;
+    size_t top;
+
+    int* take(size_t limbs) {
+        if (top == buffers.size()) buffers.push_back(LimbBuffer());
+        LimbBuffer &buf = buffers[top++];
+        if (buf.size() < limbs) {
+            buf.clear();
+            buf.resize(limbs);
+        }
+        return buf.data();
+    }
+
+    BigIntegerWorkspace(const BigIntegerWorkspace &);
+    BigIntegerWorkspace& operator=(const BigIntegerWorkspace &);
+};
+
 class BigInteger;
+class BigIntegerView;
 class Rational;
+class BigAccumulator;
+struct LazyEval;
+
+template <typename T> class LazyTerm;
+template <typename L, typename R> class LazyProduct;
+template <typename L, typename R, bool Subtract> class LazySum;
+template <typename E> class LazyNegate;
+template <typename T> struct LazyScratch;
+
+// True only for lazy(...) expression nodes evaluating to T, so that the
+// expression overloads of BigInteger and Rational never see containers
+// or other types that merely have a matching value_type.
+template <typename Expr, typename T> struct LazyExpression : std::false_type {};
+template <typename T> struct LazyExpression<LazyTerm<T>, T> : std::true_type {};
+template <typename L, typename R, typename T> struct LazyExpression<LazyProduct<L, R>, T> : LazyExpression<L, T> {};
+template <typename L, typename R, bool S, typename T> struct LazyExpression<LazySum<L, R, S>, T> : LazyExpression<L, T> {};
+template <typename E, typename T> struct LazyExpression<LazyNegate<E>, T> : LazyExpression<E, T> {};
+
+// Integer types taken by the machine-word operand overloads. bool is left
+// out: it still converts through the int constructor, but the overloads
+// test b < 0, which is meaningless (and -Wbool-compare) for a bool.
+template <typename T> struct MachineWord
+    : std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value> {};
 
 BigInteger operator*(const BigInteger &a, const BigInteger &b);
 std::ostream& operator<<(std::ostream &out, const BigInteger &a);
@@ -15,6 +746,18 @@ std::ostream& operator<<(std::ostream &out, const Rational &a);
 bool operator==(const BigInteger &a, const BigInteger &b);
 bool operator>(const BigInteger &a, const BigInteger &b);
 bool operator<(const BigInteger &a, const BigInteger &b);
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator==(const BigInteger &a, T b);
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator!=(const BigInteger &a, T b);
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator<(const BigInteger &a, T b);
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator>(const BigInteger &a, T b);
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator<=(const BigInteger &a, T b);
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator>=(const BigInteger &a, T b);
 
 
 class BigInteger {
@@ -26,33 +769,46 @@ public:
     }
 
     BigInteger(int init) {
-        if (init == 0) {
-            sign = 0;
-            body.resize(1);
-            body[0] = 0;
-        }
-        sign = -(init >> 31);
-        init = init < 0 ? -init : init;
-        size_t index = 0;
-        for (; init > 0; init /= RADIX) {
-            int rem = init % RADIX;
-            body.push_back(rem);
-            index++;
+        init_magnitude((unsigned int)(init < 0 ? 0U - (unsigned int)init : init), init < 0);
+    }
+
+    BigInteger(unsigned int init) {
+        init_magnitude(init, false);
+    }
+
+    BigInteger(long init) {
+        init_magnitude((unsigned long)(init < 0 ? 0UL - (unsigned long)init : init), init < 0);
+    }
+
+    BigInteger(unsigned long init) {
+        init_magnitude(init, false);
+    }
+
+    BigInteger(long long init) {
+        init_magnitude((unsigned long long)(init < 0 ? 0ULL - (unsigned long long)init : init), init < 0);
+    }
+
+    BigInteger(unsigned long long init) {
+        init_magnitude(init, false);
+    }
+
+    // Truncates toward zero; exact for every integral double.
+    explicit BigInteger(double init) {
+        if (!std::isfinite(init)) throw std::invalid_argument("BigInteger: non-finite double");
+        if (std::fabs(init) < 9223372036854775808.0) {
+            long long whole = (long long)init;
+            init_magnitude((unsigned long long)(whole < 0 ? 0ULL - (unsigned long long)whole : whole), whole < 0);
+            return;
         }
-    } 
+        int exp;
+        double mantissa = std::frexp(std::fabs(init), &exp);
+        init_magnitude((unsigned long long)std::ldexp(mantissa, 53), init < 0);
+        shift_bits_left(exp - 53);
+    }
 
     BigInteger(std::string s) {
-        bool keepsign = s[0] == '-' ? 1 : 0;
-        if (keepsign) {
-            s.erase(0, 1);
-        }
-        sign = keepsign;
-        BigInteger tmp = 1;
-        for (size_t i = 0; i < s.size(); i++) {
-            (*this) += tmp * (s[s.size() - i - 1] - '0'); 
-            tmp *= 10;
-        }
-        sign = keepsign;
+        BIGINT_MEMORY_OP(MEMORY_PARSE);
+        parse_decimal(s.data(), s.size());
     }
 
     BigInteger(const BigInteger &b) {
@@ -60,6 +816,8 @@ public:
         body = b.body;
     }
 
+    explicit BigInteger(const BigIntegerView &b);
+
     ~BigInteger() {}
 
     BigInteger& operator=(const BigInteger &b) {
@@ -68,8 +826,54 @@ public:
         return (*this);
     } 
 
-    BigInteger& operator+=(const BigInteger &b) {
-        if (sign ^ b.sign) { 
+    // Evaluation of a lazy(...) expression; see LazyTerm below.
+    template <typename Expr, typename = typename std::enable_if<LazyExpression<Expr, BigInteger>::value>::type>
+    explicit BigInteger(const Expr &e) {
+        sign = 0;
+        body.assign(1, 0);
+        LazyScratch<typename Expr::value_type> scratch;
+        e.accumulate(*this, false, scratch);
+    }
+
+    template <typename Expr, typename = typename std::enable_if<LazyExpression<Expr, BigInteger>::value>::type>
+    BigInteger& operator=(const Expr &e) {
+        if (e.aliases(this)) {
+            BigInteger tmp(e);
+            body.swap(tmp.body);
+            sign = tmp.sign;
+            return (*this);
+        }
+        sign = 0;
+        body.assign(1, 0);
+        LazyScratch<typename Expr::value_type> scratch;
+        e.accumulate(*this, false, scratch);
+        return (*this);
+    }
+
+    template <typename Expr, typename = typename std::enable_if<LazyExpression<Expr, BigInteger>::value>::type>
+    BigInteger& operator+=(const Expr &e) {
+        if (e.aliases(this)) return (*this) += BigInteger(e);
+        LazyScratch<typename Expr::value_type> scratch;
+        e.accumulate(*this, false, scratch);
+        return (*this);
+    }
+
+    template <typename Expr, typename = typename std::enable_if<LazyExpression<Expr, BigInteger>::value>::type>
+    BigInteger& operator-=(const Expr &e) {
+        if (e.aliases(this)) return (*this) -= BigInteger(e);
+        LazyScratch<typename Expr::value_type> scratch;
+        e.accumulate(*this, true, scratch);
+        return (*this);
+    }
+
+    BigInteger& operator+=(const BigInteger &b) {
+        BIGINT_MEMORY_OP(MEMORY_ADD);
+        long long x, y, res;
+        if (fits_word(x) && b.fits_word(y) && !__builtin_add_overflow(x, y, &res)) {
+            assign_word(res);
+            return (*this);
+        }
+        if (sign ^ b.sign) { 
             BigInteger a_abs = (*this); a_abs.abs();
             BigInteger b_abs = b; b_abs.abs();
             if ((a_abs == b_abs)) {
@@ -118,7 +922,16 @@ public:
         return (*this);
     }
 
+    BigInteger& operator+=(const BigIntegerView &b);
+    BigInteger& operator-=(const BigIntegerView &b);
+
     BigInteger& operator-=(const BigInteger &b) {
+        BIGINT_MEMORY_OP(MEMORY_ADD);
+        long long x, y, res;
+        if (fits_word(x) && b.fits_word(y) && !__builtin_sub_overflow(x, y, &res)) {
+            assign_word(res);
+            return (*this);
+        }
         if ((sign ^ b.sign) == 0) { 
             BigInteger a_abs = (*this); a_abs.abs();
             BigInteger b_abs = b; b_abs.abs(); 
@@ -198,591 +1011,4013 @@ public:
     }
 
     BigInteger& operator*=(const BigInteger &b) {
+        long long x, y, product;
+        if (fits_word(x) && b.fits_word(y) && !__builtin_mul_overflow(x, y, &product)) {
+            assign_word(product);
+            return (*this);
+        }
         if (b == 0 || this->is_zero()) {
             (*this) = 0;
             return (*this);
         }
-        BigInteger res;  
+        BIGINT_TIMED(STAT_MUL, std::max(body.size(), b.body.size()));
+        BIGINT_MEMORY_OP(MEMORY_MUL);
         int keepsign = sign ^ b.sign;
-        for (size_t i = 0; i < b.body.size(); i++) {
-            BigInteger tmp((*this));
-            tmp.mul_short(b.body[i]);
-            tmp.shift_left(i);
-            res += tmp; 
-        }
-        (*this) = res; 
-        int diff = 0;
-        while (body[body.size() - diff - 1] == 0 && body.size() - diff > 1) {
-            diff++;
-        }
-        body.resize(body.size() - diff);
+        LimbVector res(body.size() + b.body.size());
+        if (&b == this) res.resize(sqr_limbs(res.data(), body.data(), body.size()));
+        else res.resize(mul_limbs(res.data(), body.data(), body.size(), b.body.data(), b.body.size()));
+        body.swap(res);
         sign = keepsign;
         return (*this);
     }
 
-    BigInteger& operator/=(const BigInteger &divider) {
-        BigInteger rem;
-        (*this).div(divider, rem);
-        return (*this);
+    BigInteger& operator/=(const BigInteger &divider) {
+        long long x, y;
+        if (fits_word(x) && divider.fits_word(y) && y != 0) {
+            assign_word(x / y);
+            return (*this);
+        }
+        BigIntegerWorkspace ws;
+        quotient(divider, ws);
+        return (*this);
+    }
+
+    BigInteger& operator%=(const BigInteger &divider) {
+        long long x, y;
+        if (fits_word(x) && divider.fits_word(y) && y != 0) {
+            assign_word(x % y);
+            return (*this);
+        }
+        BigIntegerWorkspace ws;
+        remainder(divider, ws);
+        return (*this);
+    }
+
+    // Integral operands go to word kernels that update the limbs in place
+    // instead of converting through BigInteger(int); body only reallocates
+    // when the result outgrows its capacity. Multipliers and divisors of
+    // 2^45 and above take the general path.
+    template <typename T>
+    typename std::enable_if<MachineWord<T>::value, BigInteger&>::type operator+=(T b) {
+        add_word(word_magnitude(b), b < 0);
+        return (*this);
+    }
+
+    template <typename T>
+    typename std::enable_if<MachineWord<T>::value, BigInteger&>::type operator-=(T b) {
+        add_word(word_magnitude(b), b > 0);
+        return (*this);
+    }
+
+    template <typename T>
+    typename std::enable_if<MachineWord<T>::value, BigInteger&>::type operator*=(T b) {
+        unsigned long long magnitude = word_magnitude(b);
+        if (magnitude >= WORD_KERNEL_LIMIT) return (*this) *= word_value(magnitude, b < 0);
+        mul_word(magnitude, b < 0);
+        return (*this);
+    }
+
+    template <typename T>
+    typename std::enable_if<MachineWord<T>::value, BigInteger&>::type operator/=(T b) {
+        unsigned long long magnitude = word_magnitude(b);
+        if (magnitude == 0) throw std::domain_error("BigInteger: division by zero");
+        if (magnitude >= WORD_KERNEL_LIMIT) return (*this) /= word_value(magnitude, b < 0);
+        int keepsign = sign ^ (b < 0);
+        divmod_word(magnitude);
+        sign = is_zero() ? 0 : keepsign;
+        return (*this);
+    }
+
+    template <typename T>
+    typename std::enable_if<MachineWord<T>::value, BigInteger&>::type operator%=(T b) {
+        unsigned long long magnitude = word_magnitude(b);
+        if (magnitude == 0) throw std::domain_error("BigInteger: division by zero");
+        if (magnitude >= WORD_KERNEL_LIMIT) return (*this) %= word_value(magnitude, b < 0);
+        init_magnitude(mod_word(magnitude), sign);
+        return (*this);
+    }
+
+    BigInteger& operator++() {
+        add_word(1, false);
+        return (*this);
+    }
+
+    BigInteger& operator--() {
+        add_word(1, true);
+        return (*this);
+    }
+
+    BigInteger operator++(int) {
+        BigInteger tmp = (*this);
+        add_word(1, false);
+        return tmp;
+    }
+
+    BigInteger operator--(int) {
+        BigInteger tmp = (*this);
+        add_word(1, true);
+        return tmp;
+    }
+
+    explicit operator bool() {
+        return this->is_zero() ? false : true; 
+    }
+
+    int BigIntegerNeg() {
+        if (!this->is_zero()) sign ^= 1;
+        return 0;
+    }
+
+    bool BigIntegerSign() {
+        return sign;
+    }
+
+    int BigIntegerCompare(const BigIntegerView &b) const;
+
+    template <typename T>
+    typename std::enable_if<MachineWord<T>::value, int>::type BigIntegerCompare(T b) const {
+        return compare_word(word_magnitude(b), b < 0);
+    }
+
+    int BigIntegerCompare(const BigInteger &b) const {
+        if (this->is_zero() && b.is_zero()) return 0;
+        if (sign ^ b.sign) {
+            if (sign) {
+                return -1;
+            }
+            else {
+                return 1;
+            }
+        }
+        if (sign) {
+            if (body.size() > b.body.size()) {
+                return -1;
+            }
+            else if (body.size() < b.body.size()) {
+                return 1;
+            }
+            else {
+                for (size_t i = body.size(); i > 0; i--) {
+                    if (body[i - 1] > b.body[i - 1]){
+                        return -1;
+                    }
+                    else if (body[i - 1] < b.body[i - 1]) {
+                        return 1;
+                    }
+                }
+                return 0;
+            }
+        }
+        if (body.size() > b.body.size()) {
+            return 1;
+        }
+        else if (body.size() < b.body.size()) {
+            return -1;
+        }
+        else {
+            for (size_t i = body.size(); i > 0; i--) {
+                if (body[i - 1] > b.body[i - 1]) {
+                    return 1;
+                }
+                else if (body[i - 1] < b.body[i - 1]) {
+                    return -1;
+                }
+            }
+            return 0;
+        }
+    }
+
+    std::string toString() const { 
+        BIGINT_MEMORY_OP(MEMORY_FORMAT);
+        std::string out;
+        append_decimal(out);
+        return out;
+    }
+
+    int append_decimal(std::string &out) const {
+        std::vector<int> blocks = decimal_blocks();
+        out.reserve(out.size() + blocks.size() * DECIMAL_BLOCK_DIGITS + 1);
+        if (sign && !this->is_zero()) out.push_back('-');
+        char digits[DECIMAL_BLOCK_DIGITS];
+        for (size_t i = blocks.size(); i > 0; i--) {
+            out.append(digits, format_block(digits, blocks[i - 1], i != blocks.size()));
+        }
+        return 0;
+    }
+
+    // Parses [+-]digits in chunks of DECIMAL_BLOCK_DIGITS; returns -1 and
+    // leaves zero on any other character.
+    int parse_decimal(const char *s, size_t len) {
+        size_t i = len > 0 && (s[0] == '-' || s[0] == '+') ? 1 : 0;
+        bool newsign = i == 1 && s[0] == '-';
+        body.assign(1, 0);
+        sign = 0;
+        size_t chunk = (len - i) % DECIMAL_BLOCK_DIGITS == 0 ? DECIMAL_BLOCK_DIGITS : (len - i) % DECIMAL_BLOCK_DIGITS;
+        for (; i < len; chunk = DECIMAL_BLOCK_DIGITS) {
+            int value = 0, mult = 1;
+            for (size_t j = 0; j < chunk; j++, i++) {
+                if (s[i] < '0' || s[i] > '9') {
+                    body.assign(1, 0);
+                    return -1;
+                }
+                value = value * 10 + (s[i] - '0');
+                mult *= 10;
+            }
+            mul_add_short(mult, value);
+        }
+        sign = newsign && !this->is_zero();
+        return 0;
+    }
+    int mul(int mult) {
+        mul_short(mult);
+        return 0;
+    }
+
+    int pow(unsigned long long degree) {
+        LimbVector limbs;
+        do {
+            limbs.push_back(degree & (RADIX - 1));
+            degree >>= RADIX_BITS;
+        } while (degree > 0);
+        pow_limbs(limbs);
+        return 0;
+    }
+
+    int pow(const BigInteger &degree) {
+        if (degree.sign && !degree.is_zero()) {
+            // integer semantics: 1 / x^n truncates to zero unless |x| == 1
+            bool unit = body.size() == 1 && body[0] == 1;
+            bool odd = degree.body[0] & 1;
+            if (!unit) (*this) = 0;
+            else if (!odd) sign = 0;
+            return 0;
+        }
+        LimbVector limbs = degree.body;
+        pow_limbs(limbs);
+        return 0;
+    }
+
+    int abs() {
+        sign = 0;
+        return 0;
+    }
+
+    bool is_zero() const {
+        return body.size() == 1 && body[0] == 0;
+    }
+
+    // Returns the spare limb storage left by earlier, larger values.
+    int shrink_to_fit() {
+        body.shrink_to_fit();
+        return 0;
+    }
+
+    // Preallocates room for a value of the given number of limbs so that
+    // in-place arithmetic growing up to it does not reallocate.
+    int reserve(size_t limbs) {
+        body.reserve(limbs);
+        return 0;
+    }
+
+    // Never less than BIGINT_INLINE_LIMBS.
+    size_t capacity() const {
+        return body.capacity();
+    }
+
+    // Shifts and bitwise operators act on the infinite two's complement
+    // form, like the built-in operators on signed integers: >> rounds
+    // toward minus infinity and ~x == -x - 1.
+    BigInteger& operator<<=(size_t k) {
+        shift_bits_left(k);
+        return (*this);
+    }
+
+    BigInteger& operator>>=(size_t k) {
+        bool negative = sign && !this->is_zero();
+        bool lost = shift_bits_right(k);
+        sign = negative && !this->is_zero();
+        if (negative && lost) add_word(1, true);
+        return (*this);
+    }
+
+    BigInteger& operator&=(const BigInteger &b) {
+        return bitwise(b, std::bit_and<int>());
+    }
+
+    BigInteger& operator|=(const BigInteger &b) {
+        return bitwise(b, std::bit_or<int>());
+    }
+
+    BigInteger& operator^=(const BigInteger &b) {
+        return bitwise(b, std::bit_xor<int>());
+    }
+
+    bool test_bit(size_t n) const {
+        size_t limb = n / RADIX_BITS;
+        bool bit = limb < body.size() && (body[limb] >> (n % RADIX_BITS) & 1);
+        if (!sign || this->is_zero()) return bit;
+        // -m is ~(m - 1), and subtracting one flips the bits of m up to and
+        // including its lowest set bit.
+        return bit == (n <= ctz());
+    }
+
+    int set_bit(size_t n, bool value = true) {
+        if (test_bit(n) == value) return 0;
+        if (sign && !this->is_zero()) {
+            BigInteger power = 1;
+            power <<= n;
+            if (value) (*this) += power;
+            else (*this) -= power;
+            return 0;
+        }
+        size_t limb = n / RADIX_BITS;
+        if (limb >= body.size()) body.resize(limb + 1, 0);
+        body[limb] ^= 1 << (n % RADIX_BITS);
+        while (body.size() > 1 && body.back() == 0) body.pop_back();
+        return 0;
+    }
+
+    // bit_length, popcount and ctz describe |this|; all three are 0 for 0.
+    size_t bit_length() const {
+        size_t bits = RADIX_BITS * (body.size() - 1);
+        for (int top = body.back(); top > 0; top >>= 1) {
+            bits++;
+        }
+        return bits;
+    }
+
+    size_t popcount() const {
+        size_t count = 0;
+        for (size_t i = 0; i < body.size(); i++) {
+            count += __builtin_popcount(body[i]);
+        }
+        return count;
+    }
+
+    size_t ctz() const {
+        if (this->is_zero()) return 0;
+        size_t i = 0;
+        while (body[i] == 0) i++;
+        return i * RADIX_BITS + __builtin_ctz(body[i]);
+    }
+
+    // *this *= b with the product and the Karatsuba temporaries taken from
+    // ws. The result is copied into body, so a body reserved for it and a
+    // warmed-up workspace make the call allocation-free.
+    int mul(const BigInteger &b, BigIntegerWorkspace &ws) {
+        long long x, y, product;
+        if (fits_word(x) && b.fits_word(y) && !__builtin_mul_overflow(x, y, &product)) {
+            assign_word(product);
+            return 0;
+        }
+        if (b.is_zero() || this->is_zero()) {
+            assign_word(0);
+            return 0;
+        }
+        BIGINT_TIMED(STAT_MUL, std::max(body.size(), b.body.size()));
+        BIGINT_MEMORY_OP(MEMORY_MUL);
+        BigIntegerWorkspace::Frame frame(ws);
+        int *res = frame.take(body.size() + b.body.size());
+        size_t size;
+        if (&b == this) size = sqr_limbs(res, body.data(), body.size(), ws);
+        else size = mul_limbs(res, body.data(), body.size(), b.body.data(), b.body.size(), ws);
+        body.assign(res, res + size);
+        sign ^= b.sign;
+        return 0;
+    }
+
+    // Truncating division: *this becomes the quotient and rem the remainder,
+    // which takes the sign of the dividend. rem must not be *this.
+    int div(const BigInteger &diver, BigInteger &rem, BigIntegerWorkspace &ws) {
+        return divmod_to(diver, this, &rem, ws);
+    }
+
+    // quot = *this / diver and rem = *this % diver from a single pass of the
+    // division loop; quot and rem must be distinct objects.
+    int divmod(const BigInteger &diver, BigInteger &quot, BigInteger &rem) const {
+        BigIntegerWorkspace ws;
+        return divmod_to(diver, &quot, &rem, ws);
+    }
+
+    int divmod(const BigInteger &diver, BigInteger &quot, BigInteger &rem, BigIntegerWorkspace &ws) const {
+        return divmod_to(diver, &quot, &rem, ws);
+    }
+
+    // *this /= diver without forming the remainder.
+    int quotient(const BigInteger &diver, BigIntegerWorkspace &ws) {
+        return divmod_to(diver, this, NULL, ws);
+    }
+
+    // *this %= diver without storing the quotient.
+    int remainder(const BigInteger &diver, BigIntegerWorkspace &ws) {
+        return divmod_to(diver, NULL, this, ws);
+    }
+
+    // *this /= d for a d known to divide *this; the result is unspecified
+    // otherwise. Works from the low limbs up (Jebelean's exact division), so
+    // there is no quotient estimate and no remainder to form.
+    int divexact(const BigInteger &d) {
+        BigIntegerWorkspace ws;
+        return divexact(d, ws);
+    }
+
+    int divexact(const BigInteger &d, BigIntegerWorkspace &ws) {
+        if (d.is_zero()) throw std::domain_error("BigInteger: division by zero");
+        long long x, y;
+        if (fits_word(x) && d.fits_word(y)) {
+            assign_word(x / y);
+            return 0;
+        }
+        BIGINT_COUNT(STAT_DIV, d.body.size());
+        BIGINT_MEMORY_OP(MEMORY_DIV);
+        size_t asize = trimmed_size(), bsize = d.trimmed_size();
+        if (asize < bsize) {
+            assign_word(0);
+            return 0;
+        }
+        // Strip the factors of two so the low divisor limb is invertible.
+        size_t zeros = 0;
+        while (d.body[zeros] == 0) zeros++;
+        int shift = __builtin_ctz(d.body[zeros]);
+        BigIntegerWorkspace::Frame frame(ws);
+        asize -= zeros, bsize -= zeros;
+        int *u = frame.take(asize), *v = frame.take(bsize);
+        shift_limbs_right(u, body.data() + zeros, asize, shift);
+        shift_limbs_right(v, d.body.data() + zeros, bsize, shift);
+        while (bsize > 1 && v[bsize - 1] == 0) bsize--;
+        size_t qsize = asize - bsize + 1;
+        int *q = frame.take(qsize);
+        divexact_limbs(q, u, qsize, v, bsize);
+        while (qsize > 1 && q[qsize - 1] == 0) qsize--;
+        int keepsign = sign ^ d.sign;
+        body.assign(q, q + qsize);
+        sign = is_zero() ? 0 : keepsign;
+        return 0;
+    }
+
+    // Divisors of up to three limbs are tested in one pass over the limbs
+    // without allocating; larger ones take the remainder of algorithm D.
+    bool divisible_by(const BigInteger &d) const {
+        BigIntegerWorkspace ws;
+        return divisible_by(d, ws);
+    }
+
+    bool divisible_by(const BigInteger &d, BigIntegerWorkspace &ws) const {
+        if (d.is_zero()) return this->is_zero();
+        size_t asize = trimmed_size(), bsize = d.trimmed_size();
+        if (bsize <= 3) {
+            long long m = 0, rem = 0;
+            for (size_t i = bsize; i > 0; i--) m = (m << RADIX_BITS) | d.body[i - 1];
+            for (size_t i = asize; i > 0; i--) rem = ((rem << RADIX_BITS) | body[i - 1]) % m;
+            return rem == 0;
+        }
+        if (asize < bsize) return this->is_zero();
+        // d has at least as many trailing zero bits as anything it divides.
+        for (size_t i = 0; i < bsize; i++) {
+            if (d.body[i] == 0) {
+                if (body[i] != 0) return false;
+                continue;
+            }
+            if (__builtin_ctz(body[i] | RADIX) < __builtin_ctz(d.body[i])) return false;
+            break;
+        }
+        BigIntegerWorkspace::Frame frame(ws);
+        int *r = frame.take(bsize);
+        divmod_limbs(NULL, r, body.data(), asize, d.body.data(), bsize, ws);
+        for (size_t i = 0; i < bsize; i++) {
+            if (r[i] != 0) return false;
+        }
+        return true;
+    }
+
+    // *this = gcd(|*this|, |b|) by Euclid's algorithm on limbs in ws,
+    // finishing in machine words once both operands fit in 60 bits.
+    int gcd(const BigInteger &b) {
+        BigIntegerWorkspace ws;
+        return gcd(b, ws);
+    }
+
+    int gcd(const BigInteger &b, BigIntegerWorkspace &ws) {
+        BigIntegerWorkspace::Frame frame(ws);
+        size_t xsize = trimmed_size(), ysize = b.trimmed_size();
+        size_t size = std::max(xsize, ysize);
+        int *x = frame.take(size), *y = frame.take(size), *t = frame.take(size);
+        std::copy(body.begin(), body.begin() + xsize, x);
+        std::copy(b.body.begin(), b.body.begin() + ysize, y);
+        while (ysize > 1 || y[0] != 0) {
+            BIGINT_COUNT(STAT_GCD_STEP, ysize);
+            if (xsize <= 4 && ysize <= 4) {
+                unsigned long long xv = 0, yv = 0;
+                for (size_t i = xsize; i > 0; i--) xv = (xv << RADIX_BITS) | x[i - 1];
+                for (size_t i = ysize; i > 0; i--) yv = (yv << RADIX_BITS) | y[i - 1];
+                init_magnitude(gcd_word(xv, yv), false);
+                return 0;
+            }
+            if (xsize < ysize) {
+                std::swap(x, y);
+                std::swap(xsize, ysize);
+                continue;
+            }
+            divmod_limbs(NULL, t, x, xsize, y, ysize, ws);
+            size_t tsize = ysize;
+            while (tsize > 1 && t[tsize - 1] == 0) tsize--;
+            int *old = x;
+            x = y, xsize = ysize;
+            y = t, ysize = tsize;
+            t = old;
+        }
+        body.assign(x, x + xsize);
+        sign = 0;
+        return 0;
+    }
+
+    // Record layout: tag byte (SERIAL_VERSION << 4 | SERIAL_VARINT | SERIAL_SIGN),
+    // limb count as LEB128 varint or as three zero bytes and a u32 LE, then the
+    // 15-bit limbs as u16 LE. The fixed header keeps limbs 2-byte aligned.
+    size_t serialize(std::vector<unsigned char> &out, bool varint = false) const {
+        size_t start = out.size();
+        int tag = SERIAL_VERSION << 4;
+        if (varint) tag |= SERIAL_VARINT;
+        if (sign && !this->is_zero()) tag |= SERIAL_SIGN;
+        out.push_back(tag);
+        size_t count = body.size();
+        if (varint) {
+            for (; count >= 0x80; count >>= 7) {
+                out.push_back((count & 0x7f) | 0x80);
+            }
+            out.push_back(count);
+        }
+        else {
+            out.push_back(0);
+            out.push_back(0);
+            out.push_back(0);
+            for (int i = 0; i < 4; i++) {
+                out.push_back((count >> (8 * i)) & 0xff);
+            }
+        }
+        for (size_t i = 0; i < body.size(); i++) {
+            out.push_back(body[i] & 0xff);
+            out.push_back(body[i] >> 8);
+        }
+        return out.size() - start;
+    }
+
+    // Returns the number of bytes consumed, 0 if the record is malformed or
+    // not canonical; *this is left untouched in that case.
+    size_t deserialize(const unsigned char *data, size_t size) {
+        size_t count = 0;
+        size_t pos = read_serial_header(data, size, count);
+        if (pos == 0 || count > (size - pos) / 2) return 0;
+        LimbVector limbs(count);
+        for (size_t i = 0; i < count; i++) {
+            limbs[i] = data[pos + 2 * i] | (data[pos + 2 * i + 1] << 8);
+            if (limbs[i] >= RADIX) return 0;
+        }
+        if (count > 1 && limbs[count - 1] == 0) return 0;
+        bool newsign = data[0] & SERIAL_SIGN;
+        if (newsign && count == 1 && limbs[0] == 0) return 0;
+        body.swap(limbs);
+        sign = newsign;
+        return pos + 2 * count;
+    }
+
+    // Returns the header length and stores the limb count, 0 on a bad header.
+    static size_t read_serial_header(const unsigned char *data, size_t size, size_t &count) {
+        if (size == 0 || (data[0] >> 4) != SERIAL_VERSION || (data[0] & 0x0c)) return 0;
+        count = 0;
+        if (data[0] & SERIAL_VARINT) {
+            for (size_t i = 1; i < size && i <= 9; i++) {
+                count |= (size_t)(data[i] & 0x7f) << (7 * (i - 1));
+                // A zero final byte after continuation bytes is an overlong encoding.
+                if (!(data[i] & 0x80)) return count == 0 || (i > 1 && data[i] == 0) ? 0 : i + 1;
+            }
+            return 0;
+        }
+        if (size < SERIAL_HEADER || data[1] || data[2] || data[3]) return 0;
+        for (int i = 0; i < 4; i++) {
+            count |= (size_t)data[4 + i] << (8 * i);
+        }
+        return count == 0 ? 0 : SERIAL_HEADER;
+    }
+
+    // Magnitude import/export with mpz_import/mpz_export conventions: order
+    // and endian are 1 for most significant first, -1 for least significant
+    // first, endian 0 is the host byte order. The sign is not stored.
+    int import_bytes(size_t count, int order, size_t size, int endian, const void *op) {
+        const unsigned char *data = static_cast<const unsigned char*>(op);
+        if (endian == 0) endian = host_endian();
+        size_t total = count * size;
+        LimbVector limbs;
+        limbs.reserve(total * 8 / RADIX_BITS + 1);
+        unsigned int acc = 0;
+        int accbits = 0;
+        for (size_t k = 0; k < total; k++) {
+            size_t word = order < 0 ? k / size : count - 1 - k / size;
+            size_t byte = endian < 0 ? k % size : size - 1 - k % size;
+            acc |= (unsigned int)data[word * size + byte] << accbits;
+            accbits += 8;
+            if (accbits >= RADIX_BITS) {
+                limbs.push_back(acc & (RADIX - 1));
+                acc >>= RADIX_BITS;
+                accbits -= RADIX_BITS;
+            }
+        }
+        limbs.push_back(acc);
+        while (limbs.size() > 1 && limbs.back() == 0) limbs.pop_back();
+        body.swap(limbs);
+        sign = 0;
+        return 0;
+    }
+
+    // Fills out with whole words and returns their count, 0 for zero. A
+    // word size of 0 is rejected: out is cleared and 0 returned.
+    size_t export_bytes(std::vector<unsigned char> &out, int order, size_t size, int endian) const {
+        if (size == 0) {
+            out.clear();
+            return 0;
+        }
+        if (endian == 0) endian = host_endian();
+        size_t bits = RADIX_BITS * (body.size() - 1);
+        for (int top = body.back(); top > 0; top >>= 1) {
+            bits++;
+        }
+        size_t bytes = (bits + 7) / 8;
+        size_t count = (bytes + size - 1) / size;
+        out.assign(count * size, 0);
+        for (size_t k = 0; k < bytes; k++) {
+            size_t limb = k * 8 / RADIX_BITS;
+            int offset = k * 8 % RADIX_BITS;
+            unsigned int window = body[limb] >> offset;
+            if (limb + 1 < body.size()) window |= (unsigned int)body[limb + 1] << (RADIX_BITS - offset);
+            size_t word = order < 0 ? k / size : count - 1 - k / size;
+            size_t byte = endian < 0 ? k % size : size - 1 - k % size;
+            out[word * size + byte] = window & 0xff;
+        }
+        return count;
+    }
+
+    static const int SERIAL_KIND = 1;
+
+    // Process-wide crossover points used by multiplication and squaring.
+    // Writing to the returned struct takes effect for later operations.
+    static BigIntegerThresholds& thresholds() {
+        static BigIntegerThresholds current = {BIGINT_MUL_KARATSUBA_THRESHOLD, BIGINT_SQR_KARATSUBA_THRESHOLD};
+        return current;
+    }
+
+    // Reads "name value" lines as written by bench/tune.cpp; unknown names
+    // are skipped. Returns false, leaving the thresholds unchanged, if the
+    // file cannot be read or a value is not a positive number.
+    static bool load_thresholds(const char *path) {
+        FILE *f = fopen(path, "r");
+        if (f == NULL) return false;
+        BigIntegerThresholds loaded = thresholds();
+        char name[64];
+        unsigned long value;
+        bool ok = true;
+        int got;
+        while ((got = fscanf(f, "%63s %lu", name, &value)) == 2) {
+            if (value == 0) ok = false;
+            else if (std::string(name) == "mul_karatsuba") loaded.mul_karatsuba = value;
+            else if (std::string(name) == "sqr_karatsuba") loaded.sqr_karatsuba = value;
+        }
+        if (got != EOF) ok = false;
+        fclose(f);
+        if (ok) thresholds() = loaded;
+        return ok;
+    }
+
+    static bool save_thresholds(const char *path) {
+        FILE *f = fopen(path, "w");
+        if (f == NULL) return false;
+        fprintf(f, "mul_karatsuba %lu\n", (unsigned long)thresholds().mul_karatsuba);
+        fprintf(f, "sqr_karatsuba %lu\n", (unsigned long)thresholds().sqr_karatsuba);
+        return fclose(f) == 0;
+    }
+
+    friend class Rational;
+    friend class DecimalExpansion;
+    template <size_t Bits> friend class FixedBigInteger;
+    template <char... Digits> friend class BigIntegerLiteral;
+    friend struct LazyEval;
+    friend class BigAccumulator;
+    friend class UnreducedRational;
+    friend class RationalBatch;
+    friend int addmul(BigInteger &acc, const BigInteger &a, const BigInteger &b);
+    friend int submul(BigInteger &acc, const BigInteger &a, const BigInteger &b);
+    friend int addmul_short(BigInteger &acc, const BigInteger &a, int mult);
+    friend BigInteger dot(const BigInteger *a, const BigInteger *b, size_t count);
+    friend class BigIntegerReader;
+    friend class BigIntegerWriter;
+    friend std::istream& operator>>(std::istream &in, BigInteger &a);
+    friend std::ostream& operator<<(std::ostream &out, const BigInteger &a);
+
+private:
+    bool sign;
+    LimbVector body;  
+
+    // the lowest 64 bits of |this|
+    unsigned long long low_bits() const {
+        unsigned long long bits = 0;
+        for (size_t i = body.size() < 5 ? body.size() : 5; i > 0; i--) {
+            bits = (bits << RADIX_BITS) | body[i - 1];
+        }
+        return bits;
+    }
+
+    int shift_bits_left(size_t k) {
+        if (this->is_zero()) return 0;
+        int bits = k % RADIX_BITS;
+        if (bits) {
+            int carry = 0;
+            for (size_t i = 0; i < body.size(); i++) {
+                int cur = (body[i] << bits) | carry;
+                body[i] = cur & (RADIX - 1);
+                carry = cur >> RADIX_BITS;
+            }
+            if (carry) body.push_back(carry);
+        }
+        body.insert(body.begin(), k / RADIX_BITS, 0);
+        return 0;
+    }
+
+    // |this| >>= k; returns whether any set bits were shifted out.
+    bool shift_bits_right(size_t k) {
+        size_t limbs = k / RADIX_BITS;
+        int bits = k % RADIX_BITS;
+        if (limbs >= body.size()) {
+            bool lost = !this->is_zero();
+            body.assign(1, 0);
+            return lost;
+        }
+        bool lost = (body[limbs] & ((1 << bits) - 1)) != 0;
+        for (size_t i = 0; i < limbs; i++) {
+            lost |= body[i] != 0;
+        }
+        size_t size = body.size() - limbs;
+        shift_limbs_right(body.data(), body.data() + limbs, size, bits);
+        body.resize(size);
+        while (body.size() > 1 && body.back() == 0) body.pop_back();
+        return lost;
+    }
+
+    // this = this op b limb by limb. A negative operand is read as
+    // ~(|x| - 1), borrowing as it goes, and a negative result is written
+    // back as ~r + 1, so each operand is walked once.
+    template <typename Op>
+    BigInteger& bitwise(const BigInteger &b, Op op) {
+        bool aneg = sign && !this->is_zero(), bneg = b.sign && !b.is_zero();
+        bool rneg = op(aneg, bneg) != 0;
+        size_t asize = body.size(), bsize = b.body.size(), size = std::max(asize, bsize);
+        int afill = aneg ? RADIX - 1 : 0, bfill = bneg ? RADIX - 1 : 0, rfill = rneg ? RADIX - 1 : 0;
+        int aborrow = aneg, bborrow = bneg, rcarry = rneg;
+        body.resize(size, 0);
+        for (size_t i = 0; i < size; i++) {
+            int x = body[i] - aborrow;
+            aborrow = x < 0;
+            int y = (i < bsize ? b.body[i] : 0) - bborrow;
+            bborrow = y < 0;
+            int r = (op((x & (RADIX - 1)) ^ afill, (y & (RADIX - 1)) ^ bfill) ^ rfill) + rcarry;
+            rcarry = r >> RADIX_BITS;
+            body[i] = r & (RADIX - 1);
+        }
+        if (rcarry) body.push_back(rcarry);
+        while (body.size() > 1 && body.back() == 0) body.pop_back();
+        sign = rneg && !this->is_zero();
+        return (*this);
+    }
+
+    // For 0 <= |this| < d * 2^31: returns q = |this| / d and leaves the
+    // remainder in *this. q is estimated from the leading limbs in floating
+    // point and then corrected by at most a few add-backs.
+    long long divmod_short_quotient(const BigInteger &d) {
+        size_t ds = d.body.size();
+        size_t low = ds > 4 ? ds - 4 : 0;
+        double num = 0, den = 0;
+        for (size_t i = body.size(); i > low; i--) {
+            num = num * RADIX + body[i - 1];
+        }
+        for (size_t i = ds; i > low; i--) {
+            den = den * RADIX + d.body[i - 1];
+        }
+        long long q = (long long)(num / den);
+        if (body.size() < ds + 2) body.resize(ds + 2, 0);
+        long long carry = 0;
+        for (size_t i = 0; i < body.size(); i++) {
+            long long cur = body[i] - (i < ds ? d.body[i] * q : 0) + carry;
+            body[i] = cur & (RADIX - 1);
+            carry = cur >> RADIX_BITS;
+        }
+        while (carry < 0) {
+            q--;
+            int add = 0;
+            for (size_t i = 0; i < body.size(); i++) {
+                int cur = body[i] + (i < ds ? d.body[i] : 0) + add;
+                body[i] = cur & (RADIX - 1);
+                add = cur >> RADIX_BITS;
+            }
+            carry += add;
+        }
+        while (body.size() > 1 && body.back() == 0) body.pop_back();
+        sign = 0;
+        while (compare_abs(d.body, ds) >= 0) {
+            q++;
+            add_limbs(d.body, ds, true);
+        }
+        return q;
+    }
+
+    // Values below 2^63 in magnitude take the machine-word paths of the
+    // arithmetic operators; the limbs are only rebuilt for the result and
+    // reuse the existing capacity.
+    bool fits_word(long long &value) const {
+        if (body.size() > 5 || (body.size() == 5 && body[4] >= 8)) return false;
+        long long magnitude = 0;
+        for (size_t i = body.size(); i > 0; i--) {
+            magnitude = (magnitude << RADIX_BITS) | body[i - 1];
+        }
+        value = sign ? -magnitude : magnitude;
+        return true;
+    }
+
+    int assign_word(long long value) {
+        init_magnitude((unsigned long long)(value < 0 ? 0ULL - (unsigned long long)value : value), value < 0);
+        return 0;
+    }
+
+    static unsigned long long gcd_word(unsigned long long a, unsigned long long b) {
+        if (a == 0) return b;
+        if (b == 0) return a;
+        int shift = __builtin_ctzll(a | b);
+        a >>= __builtin_ctzll(a);
+        while (b != 0) {
+            b >>= __builtin_ctzll(b);
+            if (a > b) std::swap(a, b);
+            b -= a;
+        }
+        return a << shift;
+    }
+
+    // Sizes body exactly once; 64-bit values fit in the inline limbs.
+    template <typename U>
+    void init_magnitude(U value, bool negative) {
+        size_t limbs = 1;
+        for (U rest = value >> RADIX_BITS; rest > 0; rest >>= RADIX_BITS) {
+            limbs++;
+        }
+        body.resize(limbs);
+        for (size_t i = 0; i < limbs; i++, value >>= RADIX_BITS) {
+            body[i] = value & (RADIX - 1);
+        }
+        sign = negative && !this->is_zero();
+    }
+
+    // |this| = |this| * mult + add, for 0 <= mult, add < 2^31
+    int mul_add_short(long long mult, long long add) {
+        long long carry = add;
+        for (size_t i = 0; i < body.size(); i++) {
+            long long cur = body[i] * mult + carry;
+            body[i] = cur & (RADIX - 1);
+            carry = cur >> RADIX_BITS;
+        }
+        for (; carry > 0; carry >>= RADIX_BITS) {
+            body.push_back(carry & (RADIX - 1));
+        }
+        while (body.size() > 1 && body.back() == 0) body.pop_back();
+        return 0;
+    }
+
+    // |this| in base DECIMAL_BLOCK, least significant block first
+    std::vector<int> decimal_blocks() const {
+        std::vector<int> blocks;
+        LimbVector work;
+        decimal_blocks(blocks, work);
+        return blocks;
+    }
+
+    // Same, into caller-owned buffers so that repeated conversions reuse
+    // their capacity.
+    void decimal_blocks(std::vector<int> &blocks, LimbVector &work) const {
+        work.assign(body.begin(), body.end());
+        blocks.clear();
+        blocks.reserve(body.size() * RADIX_BITS / 29 + 1);
+        size_t size = work.size();
+        do {
+            long long rem = 0;
+            for (size_t i = size; i > 0; i--) {
+                long long cur = (rem << RADIX_BITS) | work[i - 1];
+                work[i - 1] = cur / DECIMAL_BLOCK;
+                rem = cur % DECIMAL_BLOCK;
+            }
+            while (size > 1 && work[size - 1] == 0) size--;
+            blocks.push_back(rem);
+        } while (size > 1 || work[0] > 0);
+    }
+
+    // Writes block into out, zero-padded to DECIMAL_BLOCK_DIGITS if pad.
+    static size_t format_block(char *out, int block, bool pad) {
+        size_t len = DECIMAL_BLOCK_DIGITS;
+        if (!pad) {
+            len = 1;
+            for (int rest = block / 10; rest > 0; rest /= 10) len++;
+        }
+        for (size_t i = len; i > 0; i--) {
+            out[i - 1] = DIGITS[block % 10];
+            block /= 10;
+        }
+        return len;
+    }
+
+    template <typename Limbs>
+    int compare_abs(const Limbs &b, size_t bsize) const {
+        if (body.size() != bsize) return body.size() > bsize ? 1 : -1;
+        for (size_t i = bsize; i > 0; i--) {
+            if (body[i - 1] != b[i - 1]) return body[i - 1] > b[i - 1] ? 1 : -1;
+        }
+        return 0;
+    }
+
+    // Signed in-place addition of any limb sequence indexable by b[i],
+    // without copying either operand.
+    template <typename Limbs>
+    int add_limbs(const Limbs &b, size_t bsize, bool bsign) {
+        if (bsize == 1 && b[0] == 0) return 0;
+        if (this->is_zero()) sign = bsign;
+        if (sign == bsign) {
+            if (body.size() < bsize) body.resize(bsize, 0);
+            int carry = 0;
+            size_t i = 0;
+            for (; i < bsize; i++) {
+                int sum = body[i] + b[i] + carry;
+                body[i] = sum & (RADIX - 1);
+                carry = sum >> RADIX_BITS;
+            }
+            for (; carry && i < body.size(); i++) {
+                int sum = body[i] + carry;
+                body[i] = sum & (RADIX - 1);
+                carry = sum >> RADIX_BITS;
+            }
+            if (carry) body.push_back(carry);
+            return 0;
+        }
+        int cmp = compare_abs(b, bsize);
+        int borrow = 0;
+        if (cmp == 0) {
+            body.assign(1, 0);
+            sign = 0;
+            return 0;
+        }
+        if (cmp > 0) {
+            size_t i = 0;
+            for (; i < bsize; i++) {
+                int diff = body[i] - b[i] - borrow;
+                borrow = diff < 0;
+                body[i] = diff + (borrow ? RADIX : 0);
+            }
+            for (; borrow; i++) {
+                int diff = body[i] - borrow;
+                borrow = diff < 0;
+                body[i] = diff + (borrow ? RADIX : 0);
+            }
+        }
+        else {
+            body.resize(bsize, 0);
+            for (size_t i = 0; i < bsize; i++) {
+                int diff = b[i] - body[i] - borrow;
+                borrow = diff < 0;
+                body[i] = diff + (borrow ? RADIX : 0);
+            }
+            sign = bsign;
+        }
+        while (body.size() > 1 && body.back() == 0) body.pop_back();
+        return 0;
+    }
+
+    // this += (negative ? -a * b : a * b). A product of the same sign as
+    // this is accumulated straight into body, anything else goes through a
+    // per-thread scratch product and add_limbs.
+    int addmul_limbs(const int *a, size_t asize, const int *b, size_t bsize, bool negative) {
+        if ((asize == 1 && a[0] == 0) || (bsize == 1 && b[0] == 0)) return 0;
+        if (this->is_zero()) sign = negative;
+        if (sign != negative || a == body.data() || b == body.data()) {
+            static thread_local LimbVector scratch;
+            scratch.resize(asize + bsize);
+            size_t size = mul_limbs(scratch.data(), a, asize, b, bsize);
+            return add_limbs(scratch, size, negative);
+        }
+        body.resize(std::max(body.size(), asize + bsize) + 1, 0);
+        for (size_t i = 0; i < asize; i++) {
+            if (a[i] == 0) continue;
+            long long carry = 0;
+            for (size_t j = 0; j < bsize; j++) {
+                long long cur = body[i + j] + (long long)a[i] * b[j] + carry;
+                body[i + j] = cur & (RADIX - 1);
+                carry = cur >> RADIX_BITS;
+            }
+            for (size_t k = i + bsize; carry; k++) {
+                long long cur = body[k] + carry;
+                body[k] = cur & (RADIX - 1);
+                carry = cur >> RADIX_BITS;
+            }
+        }
+        while (body.size() > 1 && body.back() == 0) body.pop_back();
+        return 0;
+    }
+
+    // Columns of a lazy-carry sum are folded back to limbs < RADIX, which
+    // makes room for LAZY_ROWS more partial products per column.
+    static const unsigned long long LAZY_ROWS = 1ULL << 33;
+
+    static int fold_columns(std::vector<unsigned long long> &cols) {
+        unsigned long long carry = 0;
+        for (size_t i = 0; i < cols.size(); i++) {
+            unsigned long long cur = cols[i] + carry;
+            cols[i] = cur & (RADIX - 1);
+            carry = cur >> RADIX_BITS;
+        }
+        for (; carry; carry >>= RADIX_BITS) {
+            cols.push_back(carry & (RADIX - 1));
+        }
+        return 0;
+    }
+
+    // Sum of a[k] * b[k]. Partial products of each sign go into their own
+    // 64-bit columns without carry handling; columns are folded only when
+    // the next term could overflow them and normalized once at the end.
+    static BigInteger dot_limbs(const BigInteger *a, const BigInteger *b, size_t count) {
+        std::vector<unsigned long long> cols[2];
+        unsigned long long pending = 0;
+        for (size_t k = 0; k < count; k++) {
+            if (a[k].is_zero() || b[k].is_zero()) continue;
+            const LimbVector &x = a[k].body, &y = b[k].body;
+            std::vector<unsigned long long> &col = cols[a[k].sign ^ b[k].sign];
+            size_t rows = std::min(x.size(), y.size());
+            if (pending + rows > LAZY_ROWS) {
+                fold_columns(cols[0]);
+                fold_columns(cols[1]);
+                pending = 0;
+            }
+            pending += rows;
+            if (col.size() < x.size() + y.size()) col.resize(x.size() + y.size(), 0);
+            for (size_t i = 0; i < x.size(); i++) {
+                unsigned long long xi = x[i];
+                if (xi == 0) continue;
+                unsigned long long *out = col.data() + i;
+                for (size_t j = 0; j < y.size(); j++) {
+                    out[j] += xi * y[j];
+                }
+            }
+        }
+        BigInteger ret, neg;
+        for (int s = 0; s < 2; s++) {
+            fold_columns(cols[s]);
+            while (cols[s].size() > 1 && cols[s].back() == 0) cols[s].pop_back();
+        }
+        if (!cols[0].empty()) ret.body.assign(cols[0].begin(), cols[0].end());
+        if (!cols[1].empty()) {
+            neg.body.assign(cols[1].begin(), cols[1].end());
+            ret.add_limbs(neg.body, neg.body.size(), true);
+        }
+        return ret;
+    }
+
+    static int host_endian() {
+        unsigned short probe = 1;
+        return *reinterpret_cast<unsigned char*>(&probe) ? -1 : 1;
+    }
+
+    // res (ressize limbs, with room for the carry) += b.
+    static int add_into(int *res, size_t ressize, const int *b, size_t bsize) {
+        int carry = 0;
+        size_t i = 0;
+        for (; i < bsize; i++) {
+            int sum = res[i] + b[i] + carry;
+            res[i] = sum & (RADIX - 1);
+            carry = sum >> RADIX_BITS;
+        }
+        for (; carry && i < ressize; i++) {
+            int sum = res[i] + carry;
+            res[i] = sum & (RADIX - 1);
+            carry = sum >> RADIX_BITS;
+        }
+        return 0;
+    }
+
+    // res -= b, where res >= b.
+    static int sub_from(int *res, size_t ressize, const int *b, size_t bsize) {
+        int borrow = 0;
+        size_t i = 0;
+        for (; i < bsize; i++) {
+            int diff = res[i] - b[i] - borrow;
+            borrow = diff < 0;
+            res[i] = diff + (borrow ? RADIX : 0);
+        }
+        for (; borrow && i < ressize; i++) {
+            int diff = res[i] - borrow;
+            borrow = diff < 0;
+            res[i] = diff + (borrow ? RADIX : 0);
+        }
+        return 0;
+    }
+
+    // Writes a + b into res (max(asize, bsize) + 1 limbs), returns the size.
+    static size_t add_limbs_to(int *res, const int *a, size_t asize, const int *b, size_t bsize) {
+        if (asize < bsize) {
+            std::swap(a, b);
+            std::swap(asize, bsize);
+        }
+        std::copy(a, a + asize, res);
+        res[asize] = 0;
+        add_into(res, asize + 1, b, bsize);
+        return res[asize] ? asize + 1 : asize;
+    }
+
+    // Picks the multiplication tier from thresholds(). Inputs may carry
+    // leading zero limbs; res needs asize + bsize limbs.
+    static size_t mul_limbs(int *res, const int *a, size_t asize, const int *b, size_t bsize) {
+        BigIntegerWorkspace ws;
+        return mul_limbs(res, a, asize, b, bsize, ws);
+    }
+
+    static size_t mul_limbs(int *res, const int *a, size_t asize, const int *b, size_t bsize, BigIntegerWorkspace &ws) {
+        if (asize < bsize) {
+            std::swap(a, b);
+            std::swap(asize, bsize);
+        }
+        if (bsize < 2 || bsize < thresholds().mul_karatsuba) {
+            BIGINT_COUNT(STAT_MUL_BASECASE, bsize);
+            return mul_basecase(res, a, asize, b, bsize);
+        }
+        BIGINT_COUNT(STAT_MUL_KARATSUBA, bsize);
+        BigIntegerWorkspace::Frame frame(ws);
+        if (asize >= 2 * bsize) {
+            std::fill(res, res + asize + bsize, 0);
+            int *part = frame.take(2 * bsize);
+            for (size_t off = 0; off < asize; off += bsize) {
+                size_t len = std::min(bsize, asize - off);
+                size_t size = mul_limbs(part, a + off, len, b, bsize, ws);
+                add_into(res + off, asize + bsize - off, part, size);
+            }
+        }
+        else {
+            // a = a1 B^m + a0, b = b1 B^m + b0, a0 b1 + a1 b0 = (a0 + a1)(b0 + b1) - a0 b0 - a1 b1.
+            size_t m = asize / 2;
+            int *z0 = frame.take(2 * m), *z2 = frame.take(asize + bsize - 2 * m);
+            int *sa = frame.take(asize - m + 1), *sb = frame.take(asize - m + 1);
+            size_t z0size = mul_limbs(z0, a, m, b, m, ws);
+            size_t z2size = mul_limbs(z2, a + m, asize - m, b + m, bsize - m, ws);
+            size_t sasize = add_limbs_to(sa, a, m, a + m, asize - m);
+            size_t sbsize = add_limbs_to(sb, b, m, b + m, bsize - m);
+            int *z1 = frame.take(sasize + sbsize);
+            size_t z1size = mul_limbs(z1, sa, sasize, sb, sbsize, ws);
+            sub_from(z1, z1size, z0, z0size);
+            sub_from(z1, z1size, z2, z2size);
+            while (z1size > 1 && z1[z1size - 1] == 0) z1size--;
+            std::fill(res, res + asize + bsize, 0);
+            std::copy(z0, z0 + z0size, res);
+            std::copy(z2, z2 + z2size, res + 2 * m);
+            add_into(res + m, asize + bsize - m, z1, z1size);
+        }
+        size_t size = asize + bsize;
+        while (size > 1 && res[size - 1] == 0) size--;
+        return size;
+    }
+
+    static size_t sqr_limbs(int *res, const int *a, size_t asize) {
+        BigIntegerWorkspace ws;
+        return sqr_limbs(res, a, asize, ws);
+    }
+
+    static size_t sqr_limbs(int *res, const int *a, size_t asize, BigIntegerWorkspace &ws) {
+        if (asize < 2 || asize < thresholds().sqr_karatsuba) {
+            BIGINT_COUNT(STAT_SQR_BASECASE, asize);
+            return sqr_basecase(res, a, asize);
+        }
+        BIGINT_COUNT(STAT_SQR_KARATSUBA, asize);
+        BigIntegerWorkspace::Frame frame(ws);
+        size_t m = asize / 2;
+        int *z0 = frame.take(2 * m), *z2 = frame.take(2 * (asize - m)), *sa = frame.take(asize - m + 1);
+        size_t z0size = sqr_limbs(z0, a, m, ws);
+        size_t z2size = sqr_limbs(z2, a + m, asize - m, ws);
+        size_t sasize = add_limbs_to(sa, a, m, a + m, asize - m);
+        int *z1 = frame.take(2 * sasize);
+        size_t z1size = sqr_limbs(z1, sa, sasize, ws);
+        sub_from(z1, z1size, z0, z0size);
+        sub_from(z1, z1size, z2, z2size);
+        while (z1size > 1 && z1[z1size - 1] == 0) z1size--;
+        std::fill(res, res + 2 * asize, 0);
+        std::copy(z0, z0 + z0size, res);
+        std::copy(z2, z2 + z2size, res + 2 * m);
+        add_into(res + m, 2 * asize - m, z1, z1size);
+        size_t size = 2 * asize;
+        while (size > 1 && res[size - 1] == 0) size--;
+        return size;
+    }
+
+    // res = a << shift for shift < RADIX_BITS; returns the bits shifted out.
+    static int shift_limbs_left(int *res, const int *a, size_t size, int shift) {
+        int carry = 0;
+        for (size_t i = 0; i < size; i++) {
+            int cur = (a[i] << shift) | carry;
+            res[i] = cur & (RADIX - 1);
+            carry = cur >> RADIX_BITS;
+        }
+        return carry;
+    }
+
+    static int shift_limbs_right(int *res, const int *a, size_t size, int shift) {
+        for (size_t i = 0; i < size; i++) {
+            int high = i + 1 < size ? a[i + 1] : 0;
+            res[i] = ((a[i] >> shift) | (high << (RADIX_BITS - shift))) & (RADIX - 1);
+        }
+        return 0;
+    }
+
+    // Shared body of div, divmod, quotient and remainder. Either output may
+    // be NULL, and either may alias *this or diver: the operands are copied
+    // into ws before anything is written.
+    int divmod_to(const BigInteger &diver, BigInteger *quot, BigInteger *rem, BigIntegerWorkspace &ws) const {
+        BIGINT_TIMED(STAT_DIV, diver.body.size());
+        BIGINT_MEMORY_OP(MEMORY_DIV);
+        if (diver.is_zero()) throw std::domain_error("BigInteger: division by zero");
+        size_t asize = trimmed_size(), bsize = diver.trimmed_size();
+        int sign_a = sign && !is_zero(), sign_q = sign_a ^ diver.sign;
+        if (asize < bsize) {
+            if (rem == this) rem->body.resize(asize);
+            else if (rem) rem->body.assign(body.begin(), body.begin() + asize);
+            if (rem) rem->sign = sign_a;
+            if (quot) quot->assign_word(0);
+            return 0;
+        }
+        BigIntegerWorkspace::Frame frame(ws);
+        size_t qsize = asize - bsize + 1, rsize = bsize;
+        int *q = quot ? frame.take(qsize) : NULL, *r = rem ? frame.take(rsize) : NULL;
+        divmod_limbs(q, r, body.data(), asize, diver.body.data(), bsize, ws);
+        if (quot) {
+            while (qsize > 1 && q[qsize - 1] == 0) qsize--;
+            quot->body.assign(q, q + qsize);
+            quot->sign = quot->is_zero() ? 0 : sign_q;
+        }
+        if (rem) {
+            while (rsize > 1 && r[rsize - 1] == 0) rsize--;
+            rem->body.assign(r, r + rsize);
+            rem->sign = rem->is_zero() ? 0 : sign_a;
+        }
+        return 0;
+    }
+
+    // Knuth's algorithm D on 15-bit limbs. a and b are trimmed, b is nonzero
+    // and asize >= bsize. q receives asize - bsize + 1 limbs and r receives
+    // bsize limbs; either may be NULL. Neither may overlap a or b.
+    static int divmod_limbs(int *q, int *r, const int *a, size_t asize, const int *b, size_t bsize, BigIntegerWorkspace &ws) {
+        if (bsize == 1) {
+            long long rem = 0;
+            for (size_t i = asize; i > 0; i--) {
+                long long cur = (rem << RADIX_BITS) | a[i - 1];
+                if (q) q[i - 1] = cur / b[0];
+                rem = cur % b[0];
+            }
+            if (r) r[0] = rem;
+            return 0;
+        }
+        BigIntegerWorkspace::Frame frame(ws);
+        // Normalize so the top divisor limb has its high bit set; the
+        // estimate from two limbs over one is then at most two too large.
+        int shift = __builtin_clz(b[bsize - 1]) - (32 - RADIX_BITS);
+        int *u = frame.take(asize + 1), *v = frame.take(bsize);
+        shift_limbs_left(v, b, bsize, shift);
+        u[asize] = shift_limbs_left(u, a, asize, shift);
+        long long vtop = v[bsize - 1], vnext = v[bsize - 2];
+        for (size_t j = asize - bsize + 1; j > 0; j--) {
+            int *uj = u + j - 1;
+            long long num = ((long long)uj[bsize] << RADIX_BITS) | uj[bsize - 1];
+            long long qhat = num / vtop, rhat = num % vtop;
+            while (qhat >= RADIX || qhat * vnext > ((rhat << RADIX_BITS) | uj[bsize - 2])) {
+                qhat--;
+                rhat += vtop;
+                if (rhat >= RADIX) break;
+            }
+            long long borrow = 0;
+            for (size_t i = 0; i < bsize; i++) {
+                long long cur = uj[i] - qhat * v[i] + borrow;
+                uj[i] = cur & (RADIX - 1);
+                borrow = cur >> RADIX_BITS;
+            }
+            long long top = uj[bsize] + borrow;
+            uj[bsize] = top & (RADIX - 1);
+            if (top < 0) {
+                qhat--;
+                int carry = 0;
+                for (size_t i = 0; i < bsize; i++) {
+                    int cur = uj[i] + v[i] + carry;
+                    uj[i] = cur & (RADIX - 1);
+                    carry = cur >> RADIX_BITS;
+                }
+                uj[bsize] = (uj[bsize] + carry) & (RADIX - 1);
+            }
+            if (q) q[j - 1] = qhat;
+        }
+        if (r) shift_limbs_right(r, u, bsize, shift);
+        return 0;
+    }
+
+    // q = u / v for odd v dividing u exactly, qsize limbs of it; u is
+    // consumed. Each step picks the quotient limb that clears the lowest
+    // remaining limb of u, using the inverse of v[0] modulo RADIX.
+    static int divexact_limbs(int *q, int *u, size_t qsize, const int *v, size_t vsize) {
+        unsigned inv = v[0];
+        for (int i = 0; i < 3; i++) {
+            inv = (inv * (2 - v[0] * inv)) & (RADIX - 1);
+        }
+        for (size_t i = 0; i < qsize; i++) {
+            long long qi = (u[i] * inv) & (RADIX - 1);
+            q[i] = qi;
+            if (qi == 0) continue;
+            size_t len = std::min(vsize, qsize - i);
+            long long borrow = 0;
+            for (size_t j = 0; j < len; j++) {
+                long long cur = u[i + j] - qi * v[j] + borrow;
+                u[i + j] = cur & (RADIX - 1);
+                borrow = cur >> RADIX_BITS;
+            }
+            for (size_t j = i + len; j < qsize && borrow != 0; j++) {
+                long long cur = u[j] + borrow;
+                u[j] = cur & (RADIX - 1);
+                borrow = cur >> RADIX_BITS;
+            }
+        }
+        return 0;
+    }
+
+    static const unsigned long long WORD_KERNEL_LIMIT = 1ULL << 45;
+
+    template <typename T>
+    static unsigned long long word_magnitude(T b) {
+        return b < 0 ? 0ULL - (unsigned long long)b : (unsigned long long)b;
+    }
+
+    static BigInteger word_value(unsigned long long magnitude, bool negative) {
+        BigInteger ret(magnitude);
+        if (negative) ret.BigIntegerNeg();
+        return ret;
+    }
+
+    // |b| as limbs on the stack; returns the limb count.
+    static size_t word_limbs(unsigned long long magnitude, int *limbs) {
+        size_t size = 0;
+        do {
+            limbs[size++] = magnitude & (RADIX - 1);
+            magnitude >>= RADIX_BITS;
+        } while (magnitude > 0);
+        return size;
+    }
+
+    int add_word(unsigned long long magnitude, bool negative) {
+        int limbs[5];
+        size_t size = word_limbs(magnitude, limbs);
+        return add_limbs(limbs, size, negative);
+    }
+
+    // For magnitude < WORD_KERNEL_LIMIT.
+    int mul_word(unsigned long long magnitude, bool negative) {
+        if (magnitude == 0 || this->is_zero()) return assign_word(0);
+        unsigned long long carry = 0;
+        for (size_t i = 0; i < body.size(); i++) {
+            unsigned long long product = body[i] * magnitude + carry;
+            body[i] = product & (RADIX - 1);
+            carry = product >> RADIX_BITS;
+        }
+        for (; carry > 0; carry >>= RADIX_BITS) {
+            body.push_back(carry & (RADIX - 1));
+        }
+        sign ^= negative;
+        return 0;
+    }
+
+    // |this| /= magnitude for 0 < magnitude < WORD_KERNEL_LIMIT; returns the
+    // remainder of the magnitudes.
+    unsigned long long divmod_word(unsigned long long magnitude) {
+        unsigned long long rem = 0;
+        for (size_t i = body.size(); i > 0; i--) {
+            unsigned long long cur = (rem << RADIX_BITS) | body[i - 1];
+            body[i - 1] = cur / magnitude;
+            rem = cur % magnitude;
+        }
+        while (body.size() > 1 && body.back() == 0) body.pop_back();
+        return rem;
+    }
+
+    unsigned long long mod_word(unsigned long long magnitude) const {
+        unsigned long long rem = 0;
+        for (size_t i = body.size(); i > 0; i--) {
+            rem = ((rem << RADIX_BITS) | body[i - 1]) % magnitude;
+        }
+        return rem;
+    }
+
+    int compare_word(unsigned long long magnitude, bool negative) const {
+        int limbs[5];
+        size_t size = word_limbs(magnitude, limbs);
+        bool this_negative = sign && !this->is_zero();
+        negative = negative && magnitude != 0;
+        if (this_negative != negative) return this_negative ? -1 : 1;
+        int cmp = compare_abs(limbs, size);
+        return this_negative ? -cmp : cmp;
+    }
+
+    size_t trimmed_size() const {
+        size_t size = body.size();
+        while (size > 1 && body[size - 1] == 0) size--;
+        return size;
+    }
+
+    static size_t mul_basecase(int *res, const int *a, size_t asize, const int *b, size_t bsize) {
+        for (size_t i = 0; i < asize + bsize; i++) {
+            res[i] = 0;
+        }
+        for (size_t i = 0; i < asize; i++) {
+            if (a[i] == 0) continue;
+            long long carry = 0;
+            for (size_t j = 0; j < bsize; j++) {
+                long long cur = res[i + j] + (long long)a[i] * b[j] + carry;
+                res[i + j] = cur & (RADIX - 1);
+                carry = cur >> RADIX_BITS;
+            }
+            res[i + bsize] = carry;
+        }
+        size_t size = asize + bsize;
+        while (size > 1 && res[size - 1] == 0) size--;
+        return size;
+    }
+
+    static size_t sqr_basecase(int *res, const int *a, size_t asize) {
+        for (size_t i = 0; i < asize << 1; i++) {
+            res[i] = 0;
+        }
+        for (size_t i = 0; i < asize; i++) {
+            long long carry = 0;
+            for (size_t j = i + 1; j < asize; j++) {
+                long long cur = res[i + j] + (long long)a[i] * a[j] + carry;
+                res[i + j] = cur & (RADIX - 1);
+                carry = cur >> RADIX_BITS;
+            }
+            res[i + asize] = carry;
+        }
+        long long carry = 0;
+        for (size_t i = 0; i < asize; i++) {
+            long long square = (long long)a[i] * a[i];
+            long long lo = ((long long)res[2 * i] << 1) + (square & (RADIX - 1)) + carry;
+            res[2 * i] = lo & (RADIX - 1);
+            carry = lo >> RADIX_BITS;
+            long long hi = ((long long)res[2 * i + 1] << 1) + (square >> RADIX_BITS) + carry;
+            res[2 * i + 1] = hi & (RADIX - 1);
+            carry = hi >> RADIX_BITS;
+        }
+        size_t size = asize << 1;
+        while (size > 1 && res[size - 1] == 0) size--;
+        return size;
+    }
+
+    // Left-to-right sliding window, same scheme as bn_pow_limbs in bn.c.
+    int pow_limbs(const LimbVector &degree) {
+        size_t degreesize = degree.size();
+        while (degreesize > 1 && degree[degreesize - 1] == 0) degreesize--;
+        if (degreesize == 1 && degree[0] == 0) {
+            (*this) = 1;
+            return 0;
+        }
+        if (this->is_zero()) {
+            sign = 0;
+            return 0;
+        }
+        bool ressign = sign && (degree[0] & 1);
+        int top = body.back();
+        bool single_bit = (top & (top - 1)) == 0;
+        for (size_t i = 0; i + 1 < body.size() && single_bit; i++) {
+            if (body[i] != 0) single_bit = false;
+        }
+        if (single_bit) {
+            unsigned long long k = RADIX_BITS * (body.size() - 1);
+            while (top > 1) {
+                top >>= 1;
+                k++;
+            }
+            if (k > 0 && (degreesize > 4 || (unsigned long long)degree[degreesize - 1] << (RADIX_BITS * (degreesize - 1)) > body.max_size() / k)) {
+                throw std::length_error("BigInteger::pow");
+            }
+            unsigned long long e = 0;
+            for (size_t i = degreesize; i > 0; i--) {
+                e = (e << RADIX_BITS) | degree[i - 1];
+            }
+            unsigned long long bit = k * e;
+            body.assign(bit / RADIX_BITS + 1, 0);
+            body.back() = 1 << (bit % RADIX_BITS);
+            sign = ressign;
+            return 0;
+        }
+        size_t bits = RADIX_BITS * (degreesize - 1);
+        for (int top_degree = degree[degreesize - 1]; top_degree > 0; top_degree >>= 1) {
+            bits++;
+        }
+        size_t window = bits <= 8 ? 1 : bits <= 24 ? 2 : bits <= 80 ? 3 : bits <= 240 ? 4 : bits <= 672 ? 5 : 6;
+        std::vector<LimbVector> table(1 << (window - 1));
+        table[0] = body;
+        if (table.size() > 1) {
+            LimbVector square(body.size() << 1);
+            square.resize(sqr_limbs(square.data(), body.data(), body.size()));
+            for (size_t i = 1; i < table.size(); i++) {
+                table[i].resize(table[i - 1].size() + square.size());
+                table[i].resize(mul_limbs(table[i].data(), table[i - 1].data(), table[i - 1].size(), square.data(), square.size()));
+            }
+        }
+        LimbVector acc, tmp;
+        auto bit_at = [&degree](size_t i) {
+            return (degree[i / RADIX_BITS] >> (i % RADIX_BITS)) & 1;
+        };
+        for (size_t i = bits; i > 0;) {
+            if (bit_at(i - 1) == 0) {
+                tmp.resize(acc.size() << 1);
+                tmp.resize(sqr_limbs(tmp.data(), acc.data(), acc.size()));
+                acc.swap(tmp);
+                i--;
+                continue;
+            }
+            size_t low = i > window ? i - window : 0;
+            while (bit_at(low) == 0) low++;
+            int value = 0;
+            for (size_t j = i; j > low; j--) {
+                value = (value << 1) | bit_at(j - 1);
+            }
+            const LimbVector &odd = table[value >> 1];
+            if (acc.empty()) {
+                acc = odd;
+                i = low;
+                continue;
+            }
+            for (size_t j = i; j > low; j--) {
+                tmp.resize(acc.size() << 1);
+                tmp.resize(sqr_limbs(tmp.data(), acc.data(), acc.size()));
+                acc.swap(tmp);
+            }
+            tmp.resize(acc.size() + odd.size());
+            tmp.resize(mul_limbs(tmp.data(), acc.data(), acc.size(), odd.data(), odd.size()));
+            acc.swap(tmp);
+            i = low;
+        }
+        body.swap(acc);
+        sign = ressign;
+        return 0;
+    }
+    
+    int shift_left(size_t k) {
+        if (k == 0) return 0;
+        body.resize(body.size() + k);
+        for (size_t i = 0; i < k; i++) {
+            body[body.size() - k + i] = 0;
+        }
+        for (size_t i = body.size(); i > k; i--) {
+            body[i - 1] = body[i - 1 - k];
+            body[i - 1 - k] = 0;
+        }
+        return 0;
+    }
+
+    int mul_short(int mult) {
+        if (this->is_zero()) (*this) = 0;
+        sign ^= -(mult >> 31);
+        mult = mult < 0 ? -mult : mult;
+        int carry = 0;
+        for (size_t i = 0; i < body.size(); i++) {
+            int product = body[i] * mult + carry;
+            body[i] = product % RADIX;
+            carry = product / RADIX;
+        }
+        if (carry) {
+            body.resize(body.size() + 1);
+            body[body.size() - 1] = carry;
+        }
+        return 0;
+    }
+
+    int div_short(int div, int &rem) {
+        if (this->is_zero()) (*this) = 0;
+        sign ^= -(div >> 31);
+        div = div < 0 ? -div : div;
+        if (body.size() == 1) {
+            rem = body[0] % div;
+            body[0] /= div;
+            return 0;
+        }
+        int curint = 0;
+        for (size_t i = body.size(); i > 0; i--) {
+            curint += body[i - 1];
+            if (curint < div) {
+                body[i - 1] = 0;
+                curint *= RADIX;
+                continue;
+            }
+            body[i - 1] = curint / div;
+            curint %= div;
+            curint *= RADIX;
+        }
+        curint /= RADIX;
+        rem = curint;
+        size_t ind = 0;
+        while (body[body.size() - ind - 1] == 0 && body.size() - ind - 1 != 0) {
+            ind++;
+        }
+        body.resize(body.size() - ind);
+        return 0;
+    }
+    
+    int div(const BigInteger &diver, BigInteger &rem) {
+        BigIntegerWorkspace ws;
+        return div(diver, rem, ws);
+    }
+};
+
+BigInteger operator+(const BigInteger &a, const BigInteger &b) {
+    BigInteger tmp = a;
+    tmp += b;
+    return tmp;
+}
+
+BigInteger operator-(const BigInteger &a, const BigInteger &b) {
+    BigInteger tmp = a;
+    tmp -= b;
+    return tmp;
+}
+
+BigInteger operator*(const BigInteger &a, const BigInteger &b) {
+    BigInteger tmp = a;
+    tmp *= b;
+    return tmp;
+}
+
+BigInteger operator/(const BigInteger &a, const BigInteger &b) {
+    BigInteger tmp = a;
+    tmp /= b;
+    return tmp;
+}
+
+BigInteger operator%(const BigInteger &a, const BigInteger &b) {
+    BigInteger tmp = a;
+    tmp %= b;
+    return tmp;
+}
+
+BigInteger operator<<(const BigInteger &a, size_t k) {
+    BigInteger tmp = a;
+    tmp <<= k;
+    return tmp;
+}
+
+BigInteger operator>>(const BigInteger &a, size_t k) {
+    BigInteger tmp = a;
+    tmp >>= k;
+    return tmp;
+}
+
+BigInteger operator&(const BigInteger &a, const BigInteger &b) {
+    BigInteger tmp = a;
+    tmp &= b;
+    return tmp;
+}
+
+BigInteger operator|(const BigInteger &a, const BigInteger &b) {
+    BigInteger tmp = a;
+    tmp |= b;
+    return tmp;
+}
+
+BigInteger operator^(const BigInteger &a, const BigInteger &b) {
+    BigInteger tmp = a;
+    tmp ^= b;
+    return tmp;
+}
+
+BigInteger operator~(const BigInteger &a) {
+    BigInteger tmp = a;
+    tmp.BigIntegerNeg();
+    --tmp;
+    return tmp;
+}
+
+// Truncating quotient and remainder, laid out like std::div_t.
+struct BigIntegerDivmod {
+    BigInteger quot;
+    BigInteger rem;
+};
+
+BigIntegerDivmod divmod(const BigInteger &a, const BigInteger &b) {
+    BigIntegerDivmod ret;
+    a.divmod(b, ret.quot, ret.rem);
+    return ret;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, BigInteger>::type operator+(const BigInteger &a, T b) {
+    BigInteger tmp = a;
+    tmp += b;
+    return tmp;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, BigInteger>::type operator-(const BigInteger &a, T b) {
+    BigInteger tmp = a;
+    tmp -= b;
+    return tmp;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, BigInteger>::type operator*(const BigInteger &a, T b) {
+    BigInteger tmp = a;
+    tmp *= b;
+    return tmp;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, BigInteger>::type operator/(const BigInteger &a, T b) {
+    BigInteger tmp = a;
+    tmp /= b;
+    return tmp;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, BigInteger>::type operator%(const BigInteger &a, T b) {
+    BigInteger tmp = a;
+    tmp %= b;
+    return tmp;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, BigInteger>::type operator+(T a, const BigInteger &b) {
+    BigInteger tmp = b;
+    tmp += a;
+    return tmp;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, BigInteger>::type operator-(T a, const BigInteger &b) {
+    BigInteger tmp = b;
+    tmp -= a;
+    tmp.BigIntegerNeg();
+    return tmp;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, BigInteger>::type operator*(T a, const BigInteger &b) {
+    BigInteger tmp = b;
+    tmp *= a;
+    return tmp;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator==(const BigInteger &a, T b) {
+    return a.BigIntegerCompare(b) == 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator!=(const BigInteger &a, T b) {
+    return a.BigIntegerCompare(b) != 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator<(const BigInteger &a, T b) {
+    return a.BigIntegerCompare(b) < 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator>(const BigInteger &a, T b) {
+    return a.BigIntegerCompare(b) > 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator<=(const BigInteger &a, T b) {
+    return a.BigIntegerCompare(b) <= 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator>=(const BigInteger &a, T b) {
+    return a.BigIntegerCompare(b) >= 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator==(T a, const BigInteger &b) {
+    return b.BigIntegerCompare(a) == 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator!=(T a, const BigInteger &b) {
+    return b.BigIntegerCompare(a) != 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator<(T a, const BigInteger &b) {
+    return b.BigIntegerCompare(a) > 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator>(T a, const BigInteger &b) {
+    return b.BigIntegerCompare(a) < 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator<=(T a, const BigInteger &b) {
+    return b.BigIntegerCompare(a) >= 0;
+}
+
+template <typename T>
+typename std::enable_if<MachineWord<T>::value, bool>::type operator>=(T a, const BigInteger &b) {
+    return b.BigIntegerCompare(a) <= 0;
+}
+
+BigInteger operator-(const BigInteger &a) {
+    BigInteger ret = a;
+    ret.BigIntegerNeg();
+    return ret;
+}
+
+bool operator==(const BigInteger &a, const BigInteger &b) {
+    int res = a.BigIntegerCompare(b);
+    return res == 0 ? true : false;
+}
+
+bool operator!=(const BigInteger &a, const BigInteger &b) {
+    int res = a.BigIntegerCompare(b);
+    return res != 0 ? true : false;
+}
+
+bool operator<(const BigInteger &a, const BigInteger &b) {
+    int res = a.BigIntegerCompare(b);
+    return res == -1 ? true : false;
+}
+
+bool operator>(const BigInteger &a, const BigInteger &b) {
+    int res = a.BigIntegerCompare(b);
+    return res == 1 ? true : false;
+}
+
+bool operator<=(const BigInteger &a, const BigInteger &b) {
+    int res = a.BigIntegerCompare(b);
+    return res != 1 ? true : false;
+}
+
+bool operator>=(const BigInteger &a, const BigInteger &b) {
+    int res = a.BigIntegerCompare(b);
+    return res != -1 ? true : false;
+}
+
+// Buffered decimal reader over a stream or an in-memory range such as a
+// mapped file. Digits are folded into the value DECIMAL_BLOCK_DIGITS at a
+// time as they are scanned; tokens are separated by whitespace.
+class BigIntegerReader {
+public:
+    explicit BigIntegerReader(std::istream &in, size_t buffer_size = 1 << 16) : buffer(buffer_size > 0 ? buffer_size : 1) {
+        this->in = &in;
+        data = buffer.data();
+        pos = 0;
+        size = 0;
+        failed = false;
+    }
+
+    BigIntegerReader(const char *begin, size_t length) {
+        in = nullptr;
+        data = begin;
+        pos = 0;
+        size = length;
+        failed = false;
+    }
+
+    // false at the end of input or on a malformed token, see fail()
+    bool read(BigInteger &x) {
+        int c = peek();
+        while (c != EOF && isspace(c)) {
+            pos++;
+            c = peek();
+        }
+        if (c == EOF) return false;
+        bool keepsign = c == '-';
+        if (c == '-' || c == '+') {
+            pos++;
+            c = peek();
+        }
+        x.body.assign(1, 0);
+        int value = 0, mult = 1;
+        size_t digits = 0;
+        for (; c >= '0' && c <= '9'; c = peek()) {
+            value = value * 10 + (c - '0');
+            mult *= 10;
+            digits++;
+            pos++;
+            if (mult == DECIMAL_BLOCK) {
+                x.mul_add_short(mult, value);
+                value = 0;
+                mult = 1;
+            }
+        }
+        x.mul_add_short(mult, value);
+        x.sign = keepsign && !x.is_zero();
+        if (digits == 0 || (c != EOF && !isspace(c))) {
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    bool fail() const {
+        return failed;
+    }
+
+private:
+    std::istream *in;
+    std::vector<char> buffer;
+    const char *data;
+    size_t pos;
+    size_t size;
+    bool failed;
+
+    int peek() {
+        if (pos == size && !fill()) return EOF;
+        return (unsigned char)data[pos];
+    }
+
+    bool fill() {
+        if (in == nullptr) return false;
+        in->read(buffer.data(), buffer.size());
+        size = in->gcount();
+        pos = 0;
+        return size > 0;
+    }
+};
+
+// Buffered decimal writer; each value goes out block by block through a
+// fixed buffer, so no per-value string is built. The blocks come out of
+// the conversion least significant first, so they are collected in a
+// buffer that is kept across writes.
+class BigIntegerWriter {
+public:
+    explicit BigIntegerWriter(std::ostream &out, size_t buffer_size = 1 << 16) : out(out), buffer(buffer_size > DECIMAL_BLOCK_DIGITS ? buffer_size : DECIMAL_BLOCK_DIGITS + 1) {
+        size = 0;
+    }
+
+    BigIntegerWriter(const BigIntegerWriter &) = delete;
+    BigIntegerWriter& operator=(const BigIntegerWriter &) = delete;
+
+    ~BigIntegerWriter() {
+        flush();
+    }
+
+    int write(const BigInteger &x) {
+        x.decimal_blocks(blocks, work);
+        if (x.sign && !x.is_zero()) put('-');
+        for (size_t i = blocks.size(); i > 0; i--) {
+            if (size + DECIMAL_BLOCK_DIGITS > buffer.size()) flush();
+            size += BigInteger::format_block(buffer.data() + size, blocks[i - 1], i != blocks.size());
+        }
+        return 0;
+    }
+
+    int put(char c) {
+        if (size == buffer.size()) flush();
+        buffer[size++] = c;
+        return 0;
+    }
+
+    int flush() {
+        out.write(buffer.data(), size);
+        size = 0;
+        return 0;
+    }
+
+private:
+    std::ostream &out;
+    std::vector<char> buffer;
+    size_t size;
+    std::vector<int> blocks;
+    LimbVector work;
+};
+
+// Reads the token straight from the stream buffer in chunks of
+// DECIMAL_BLOCK_DIGITS, without an intermediate string.
+std::istream& operator>>(std::istream &in, BigInteger &a) {
+    std::istream::sentry guard(in);
+    if (!guard) return in;
+    std::streambuf *buf = in.rdbuf();
+    int c = buf->sgetc();
+    bool keepsign = c == '-';
+    if (c == '-' || c == '+') c = buf->snextc();
+    a.body.assign(1, 0);
+    int value = 0, mult = 1;
+    size_t digits = 0;
+    for (; c >= '0' && c <= '9'; c = buf->snextc()) {
+        value = value * 10 + (c - '0');
+        mult *= 10;
+        digits++;
+        if (mult == DECIMAL_BLOCK) {
+            a.mul_add_short(mult, value);
+            value = 0;
+            mult = 1;
+        }
+    }
+    a.mul_add_short(mult, value);
+    a.sign = keepsign && !a.is_zero();
+    if (c == std::char_traits<char>::eof()) in.setstate(std::ios_base::eofbit);
+    if (digits == 0) in.setstate(std::ios_base::failbit);
+    return in;
+}
+
+// With a field width set the number is formatted into a string first, so
+// that fill and adjust apply to all of it; otherwise the decimal blocks go
+// straight to the stream.
+std::ostream& operator<<(std::ostream &out, const BigInteger &a) {
+    if (out.width() > 0) {
+        std::string s = a.toString();
+        return out << s;
+    }
+    std::vector<int> blocks = a.decimal_blocks();
+    if (a.sign && !a.is_zero()) out.put('-');
+    char digits[DECIMAL_BLOCK_DIGITS];
+    for (size_t i = blocks.size(); i > 0; i--) {
+        out.write(digits, BigInteger::format_block(digits, blocks[i - 1], i != blocks.size()));
+    }
+    return out;
+}
+
+std::string& reverse(std::string &s) {
+    for (size_t i = 0; i < s.size() / 2; i++) {
+        std::swap(s[i], s[s.size() - i - 1]);
+    }
+    return s;
+}
+
+// Read-only integer over a serialized record (see BigInteger::serialize);
+// the limbs are read straight from the underlying buffer, which must
+// outlive the view. Limb values are trusted, only the header and the
+// top limb are checked.
+class BigIntegerView {
+public:
+    BigIntegerView() {
+        static const unsigned char zero[2] = {0, 0};
+        limbs = zero;
+        count = 1;
+        sign = false;
+    }
+
+    size_t view(const unsigned char *data, size_t size) {
+        size_t newcount = 0;
+        size_t pos = BigInteger::read_serial_header(data, size, newcount);
+        if (pos == 0 || newcount > (size - pos) / 2) return 0;
+        const unsigned char *newlimbs = data + pos;
+        int top = newlimbs[2 * newcount - 2] | (newlimbs[2 * newcount - 1] << 8);
+        bool newsign = data[0] & SERIAL_SIGN;
+        if (top >= RADIX || (newcount > 1 && top == 0) || (newcount == 1 && top == 0 && newsign)) return 0;
+        limbs = newlimbs;
+        count = newcount;
+        sign = newsign;
+        return pos + 2 * count;
+    }
+
+    int operator[](size_t i) const {
+        return limbs[2 * i] | (limbs[2 * i + 1] << 8);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool BigIntegerSign() const {
+        return sign;
+    }
+
+    bool is_zero() const {
+        return count == 1 && limbs[0] == 0 && limbs[1] == 0;
+    }
+
+    int BigIntegerCompare(const BigIntegerView &b) const {
+        if (sign != b.sign) return sign ? -1 : 1;
+        int cmp = 0;
+        if (count != b.count) {
+            cmp = count > b.count ? 1 : -1;
+        }
+        else {
+            for (size_t i = count; i > 0 && cmp == 0; i--) {
+                if ((*this)[i - 1] != b[i - 1]) cmp = (*this)[i - 1] > b[i - 1] ? 1 : -1;
+            }
+        }
+        return sign ? -cmp : cmp;
+    }
+
+    std::string toString() const {
+        return BigInteger(*this).toString();
+    }
+
+private:
+    const unsigned char *limbs;
+    size_t count;
+    bool sign;
+};
+
+BigInteger::BigInteger(const BigIntegerView &b) {
+    sign = b.BigIntegerSign();
+    body.resize(b.size());
+    for (size_t i = 0; i < b.size(); i++) {
+        body[i] = b[i];
+    }
+}
+
+BigInteger& BigInteger::operator+=(const BigIntegerView &b) {
+    add_limbs(b, b.size(), b.BigIntegerSign());
+    return (*this);
+}
+
+BigInteger& BigInteger::operator-=(const BigIntegerView &b) {
+    add_limbs(b, b.size(), !b.BigIntegerSign());
+    return (*this);
+}
+
+int BigInteger::BigIntegerCompare(const BigIntegerView &b) const {
+    if (this->is_zero() && b.is_zero()) return 0;
+    if (this->is_zero()) return b.BigIntegerSign() ? 1 : -1;
+    if (sign != b.BigIntegerSign()) return sign ? -1 : 1;
+    int cmp = compare_abs(b, b.size());
+    return sign ? -cmp : cmp;
+}
+
+int view_compare(const BigIntegerView &a, const BigIntegerView &b) {
+    return a.BigIntegerCompare(b);
+}
+
+int view_compare(const BigInteger &a, const BigIntegerView &b) {
+    return a.BigIntegerCompare(b);
+}
+
+int view_compare(const BigIntegerView &a, const BigInteger &b) {
+    return -b.BigIntegerCompare(a);
+}
+
+// Comparisons for any mix of views and integers with at least one view.
+template <typename A, typename B>
+auto operator==(const A &a, const B &b) -> decltype(view_compare(a, b) == 0) {
+    return view_compare(a, b) == 0;
+}
+
+template <typename A, typename B>
+auto operator!=(const A &a, const B &b) -> decltype(view_compare(a, b) != 0) {
+    return view_compare(a, b) != 0;
+}
+
+template <typename A, typename B>
+auto operator<(const A &a, const B &b) -> decltype(view_compare(a, b) < 0) {
+    return view_compare(a, b) < 0;
+}
+
+template <typename A, typename B>
+auto operator>(const A &a, const B &b) -> decltype(view_compare(a, b) > 0) {
+    return view_compare(a, b) > 0;
+}
+
+template <typename A, typename B>
+auto operator<=(const A &a, const B &b) -> decltype(view_compare(a, b) <= 0) {
+    return view_compare(a, b) <= 0;
+}
+
+template <typename A, typename B>
+auto operator>=(const A &a, const B &b) -> decltype(view_compare(a, b) >= 0) {
+    return view_compare(a, b) >= 0;
+}
+
+std::ostream& operator<<(std::ostream &out, const BigIntegerView &a) {
+    out << a.toString();
+    return out;
+}
+
+// Read-only mapping of a file written by serialize(const BigInteger*, ...).
+// Opening walks the record headers once to index the views; limbs are
+// never copied or converted. POSIX only, compiled in with -DBIGINT_MMAP.
+#ifdef BIGINT_MMAP
+class MappedBigIntegers {
+public:
+    MappedBigIntegers() {
+        data = nullptr;
+        length = 0;
+    }
+
+    MappedBigIntegers(const MappedBigIntegers &) = delete;
+    MappedBigIntegers& operator=(const MappedBigIntegers &) = delete;
+
+    ~MappedBigIntegers() {
+        close();
+    }
+
+    // 0 on success, -1 if the file cannot be mapped or is malformed
+    int open(const char *path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return -1;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < SERIAL_ARRAY_HEADER) {
+            ::close(fd);
+            return -1;
+        }
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) return -1;
+        data = static_cast<const unsigned char*>(map);
+        length = st.st_size;
+        if (index() != 0) {
+            close();
+            return -1;
+        }
+        return 0;
+    }
+
+    int close() {
+        if (data != nullptr) munmap(const_cast<unsigned char*>(data), length);
+        data = nullptr;
+        length = 0;
+        views.clear();
+        return 0;
+    }
+
+    size_t size() const {
+        return views.size();
+    }
+
+    const BigIntegerView& operator[](size_t i) const {
+        return views[i];
+    }
+
+    const BigIntegerView* begin() const {
+        return views.data();
+    }
+
+    const BigIntegerView* end() const {
+        return views.data() + views.size();
+    }
+
+private:
+    const unsigned char *data;
+    size_t length;
+    std::vector<BigIntegerView> views;
+
+    int index() {
+        if (data[0] != 'B' || data[1] != 'I' || data[2] != 'G' || data[3] != 'N') return -1;
+        if (data[4] != SERIAL_VERSION || data[5] != BigInteger::SERIAL_KIND || data[6] || data[7]) return -1;
+        unsigned long long count = 0;
+        for (int i = 0; i < 8; i++) {
+            count |= (unsigned long long)data[8 + i] << (8 * i);
+        }
+        if (count > (length - SERIAL_ARRAY_HEADER) / SERIAL_MIN_RECORD) return -1;
+        // Grown record by record, so a bad count cannot force a large
+        // allocation before the records behind it have been checked.
+        size_t pos = SERIAL_ARRAY_HEADER;
+        for (size_t i = 0; i < count; i++) {
+            BigIntegerView view;
+            size_t len = view.view(data + pos, length - pos);
+            if (len == 0) return -1;
+            views.push_back(view);
+            pos += len;
+        }
+        return 0;
+    }
+};
+#endif
+
+class Rational {
+public:
+    Rational() {
+        numerator = 0;
+        denominator = 1;
+    }
+    
+    Rational(const BigInteger &a, const BigInteger &b) {
+        numerator = a;
+        denominator = b;
+        if (denominator < 0) {
+            numerator.BigIntegerNeg();
+            denominator.BigIntegerNeg();
+        }
+        (*this).reduce();
+    }
+
+    Rational(const BigInteger &a) {
+        numerator = a;
+        denominator = 1;
+    }
+
+    Rational(int a) {
+        numerator = a;
+        denominator = 1;
+    }
+
+    Rational(unsigned int a) : numerator(a), denominator(1) {}
+    Rational(long a) : numerator(a), denominator(1) {}
+    Rational(unsigned long a) : numerator(a), denominator(1) {}
+    Rational(long long a) : numerator(a), denominator(1) {}
+    Rational(unsigned long long a) : numerator(a), denominator(1) {}
+
+    // Exact dyadic value m * 2^e of a finite double; the odd mantissa makes
+    // the fraction already reduced, so no gcd is needed.
+    Rational(double a) : denominator(1) {
+        if (!std::isfinite(a)) throw std::invalid_argument("Rational: non-finite double");
+        if (a == 0) return;
+        int exp;
+        long long mantissa = (long long)std::ldexp(std::frexp(a, &exp), 53);
+        exp -= 53;
+        while ((mantissa & 1) == 0) {
+            mantissa /= 2;
+            exp++;
+        }
+        numerator = BigInteger(mantissa);
+        if (exp > 0) numerator.shift_bits_left(exp);
+        else denominator.shift_bits_left(-exp);
+    }
+
+    Rational(const Rational &b) {
+        numerator = b.numerator;
+        denominator = b.denominator;
+    }
+
+    Rational& operator=(const Rational &b) {
+        numerator = b.numerator;
+        denominator = b.denominator;
+        return (*this);
+    }
+
+    // A lazy(...) expression is summed over one common denominator and
+    // reduced once at the end.
+    template <typename Expr, typename = typename std::enable_if<LazyExpression<Expr, Rational>::value>::type>
+    explicit Rational(const Expr &e) : numerator(0), denominator(1) {
+        LazyScratch<typename Expr::value_type> scratch;
+        e.accumulate(*this, false, scratch);
+        (*this).reduce();
+    }
+
+    template <typename Expr, typename = typename std::enable_if<LazyExpression<Expr, Rational>::value>::type>
+    Rational& operator=(const Expr &e) {
+        if (e.aliases(this)) return (*this) = Rational(e);
+        numerator = 0;
+        denominator = 1;
+        LazyScratch<typename Expr::value_type> scratch;
+        e.accumulate(*this, false, scratch);
+        (*this).reduce();
+        return (*this);
+    }
+
+    template <typename Expr, typename = typename std::enable_if<LazyExpression<Expr, Rational>::value>::type>
+    Rational& operator+=(const Expr &e) {
+        if (e.aliases(this)) return (*this) += Rational(e);
+        LazyScratch<typename Expr::value_type> scratch;
+        e.accumulate(*this, false, scratch);
+        (*this).reduce();
+        return (*this);
+    }
+
+    template <typename Expr, typename = typename std::enable_if<LazyExpression<Expr, Rational>::value>::type>
+    Rational& operator-=(const Expr &e) {
+        if (e.aliases(this)) return (*this) -= Rational(e);
+        LazyScratch<typename Expr::value_type> scratch;
+        e.accumulate(*this, true, scratch);
+        (*this).reduce();
+        return (*this);
+    }
+
+    Rational& operator+=(const Rational &b) {
+        BIGINT_MEMORY_OP(MEMORY_RATIONAL);
+        numerator = numerator * b.denominator + b.numerator * denominator;
+        denominator *= b.denominator;
+        (*this).reduce();
+        return (*this);
+    }
+
+    Rational& operator-=(const Rational &b) {
+        BIGINT_MEMORY_OP(MEMORY_RATIONAL);
+        numerator = numerator * b.denominator - b.numerator * denominator;
+        denominator *= b.denominator;
+        (*this).reduce();
+        return (*this);
+    }
+
+    Rational& operator*=(const Rational &b) {
+        BIGINT_MEMORY_OP(MEMORY_RATIONAL);
+        numerator *= b.numerator;
+        denominator *= b.denominator;
+        (*this).reduce();
+        return (*this);
+    }
+
+    Rational& operator/=(const Rational &b) {
+        BIGINT_MEMORY_OP(MEMORY_RATIONAL);
+        numerator *= b.denominator;
+        denominator *= b.numerator;
+        if (denominator < 0) {
+            numerator.BigIntegerNeg();
+            denominator.BigIntegerNeg();
+        }
+        (*this).reduce();
+        return (*this); 
+    }
+
+    std::string toString() const { 
+        std::string s_numer = numerator.toString();
+        if (denominator == 1 || numerator == 0) return s_numer;
+        std::string ret; 
+        std::string s_denom = denominator.toString();
+        ret += s_numer;
+        ret += '/';
+        ret += s_denom;
+        return ret;
+    }
+
+    int RationalNeg() {
+        numerator.BigIntegerNeg();
+        return 0;
+    }
+
+    // reduce() leaves both parts in the buffers that held the unreduced
+    // cross products; this hands the slack back.
+    int shrink_to_fit() {
+        numerator.shrink_to_fit();
+        denominator.shrink_to_fit();
+        return 0;
+    }
+
+    std::string asDecimal(size_t precision=0) const;
+
+    size_t serialize(std::vector<unsigned char> &out, bool varint = false) const {
+        size_t written = numerator.serialize(out, varint);
+        return written + denominator.serialize(out, varint);
+    }
+
+    // Only the canonical form is accepted: a positive denominator and a
+    // fraction in lowest terms, so equality and hashing stay componentwise.
+    size_t deserialize(const unsigned char *data, size_t size) {
+        BigInteger numer, denom;
+        size_t pos = numer.deserialize(data, size);
+        if (pos == 0) return 0;
+        size_t len = denom.deserialize(data + pos, size - pos);
+        if (len == 0 || denom.BigIntegerSign() || denom.is_zero()) return 0;
+        BigInteger common = numer;
+        common.gcd(denom);
+        if (common != 1) return 0;
+        numerator = numer;
+        denominator = denom;
+        return pos + len;
+    }
+
+    static const int SERIAL_KIND = 2;
+
+    // Correctly rounded (to nearest, ties to even), including subnormal
+    // results and overflow to infinity. The quotient is taken to 55-56
+    // significant bits and the remainder only contributes a sticky bit.
+    explicit operator double() const {
+        if (numerator.is_zero()) return 0.0;
+        double sign = numerator.sign ? -1.0 : 1.0;
+        long long la = numerator.bit_length(), ld = denominator.bit_length();
+        if (la <= 53 && ld <= 53) {
+            return sign * (double)numerator.low_bits() / (double)denominator.low_bits();
+        }
+        long long e = la - ld;
+        if (e > 1025) return sign * HUGE_VAL;
+        if (e < -1077) return sign * 0.0;
+        long long k = 55 - e;
+        BigInteger numer = numerator, denom = denominator;
+        numer.abs();
+        if (k > 0) numer.shift_bits_left(k);
+        else denom.shift_bits_left(-k);
+        BigInteger quot = numer / denom;
+        numer -= quot * denom;
+        bool sticky = !numer.is_zero();
+        unsigned long long q = quot.low_bits();
+        int qb = quot.bit_length();
+        e = qb - 1 - k;
+        int keep = e >= -1022 ? 53 : 53 - (int)(-1022 - e);
+        int drop = qb - keep;
+        if (drop > 60) return sign * 0.0;
+        unsigned long long m = q >> drop;
+        unsigned long long rest = q & ((1ULL << drop) - 1);
+        unsigned long long half = 1ULL << (drop - 1);
+        if (rest > half || (rest == half && (sticky || (m & 1)))) m++;
+        return sign * std::ldexp((double)m, (int)(e + 1 - keep));
+    }
+
+    friend bool operator==(const Rational &a, const Rational &b);
+    friend bool operator!=(const Rational &a, const Rational &b); 
+    friend bool operator>(const Rational &a, const Rational &b);
+    friend bool operator<(const Rational &a, const Rational &b);
+    friend bool operator>=(const Rational &a, const Rational &b);
+    friend bool operator<=(const Rational &a, const Rational &b);
+private:
+    BigInteger numerator;
+    BigInteger denominator;
+
+    int reduce() {
+        BigIntegerWorkspace ws;
+        return reduce(ws);
+    }
+
+    int reduce(BigIntegerWorkspace &ws) {
+        BigInteger gcd;
+        return reduce(ws, gcd);
+    }
+
+    // gcd receives the common factor; passing the same integer and
+    // workspace on every call makes a warmed-up reduction allocation-free.
+    int reduce(BigIntegerWorkspace &ws, BigInteger &gcd) {
+        // if (numerator == 0) return 0;
+        long long n, d;
+        if (numerator.fits_word(n) && denominator.fits_word(d)) {
+            unsigned long long n_abs = n < 0 ? 0ULL - (unsigned long long)n : n;
+            unsigned long long d_abs = d < 0 ? 0ULL - (unsigned long long)d : d;
+            long long g = BigInteger::gcd_word(n_abs, d_abs);
+            if (g > 1) {
+                numerator.assign_word(n / g);
+                denominator.assign_word(d / g);
+            }
+            return 0;
+        }
+        BIGINT_TIMED(STAT_REDUCE, denominator.body.size());
+        BIGINT_MEMORY_OP(MEMORY_REDUCE);
+        gcd = numerator;
+        gcd.gcd(denominator, ws);
+        if (gcd == 1) return 0;
+        numerator.divexact(gcd, ws);
+        denominator.divexact(gcd, ws);
+        return 0;
+    }
+
+    friend class DecimalExpansion;
+    friend struct LazyEval;
+    friend class UnreducedRational;
+    friend class RationalBatch;
+};
+
+// Streams the decimal expansion of |r| on demand: the integer part is
+// computed once, then fractional digits are produced DECIMAL_BLOCK_DIGITS
+// at a time by one short multiplication and one division with a short
+// quotient, so the cost per block is linear in the denominator size.
+// Denominators below 2^31 run entirely in machine words.
+class DecimalExpansion {
+public:
+    explicit DecimalExpansion(const Rational &r) {
+        sign = r.numerator.sign && !r.numerator.is_zero();
+        whole = r.numerator;
+        whole.abs();
+        denom = r.denominator;
+        whole.div(denom, rem);
+        small = denom.bit_length() < 31;
+        if (small) {
+            rem64 = rem.low_bits();
+            denom64 = denom.low_bits();
+        }
+        chunk_pos = DECIMAL_BLOCK_DIGITS;
+    }
+
+    bool negative() const {
+        return sign;
+    }
+
+    // |r| rounded toward zero
+    const BigInteger& integer_part() const {
+        return whole;
+    }
+
+    // true once every remaining digit is zero
+    bool exact() const {
+        if (chunk_pos < DECIMAL_BLOCK_DIGITS) {
+            for (size_t i = chunk_pos; i < DECIMAL_BLOCK_DIGITS; i++) {
+                if (chunk[i] != '0') return false;
+            }
+        }
+        return small ? rem64 == 0 : rem.is_zero();
+    }
+
+    int next() {
+        if (chunk_pos == DECIMAL_BLOCK_DIGITS) refill();
+        return chunk[chunk_pos++] - '0';
+    }
+
+    // Writes the next count fractional digits as characters.
+    size_t digits(char *out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (chunk_pos == DECIMAL_BLOCK_DIGITS) refill();
+            out[i] = chunk[chunk_pos++];
+        }
+        return count;
+    }
+
+private:
+    bool sign;
+    bool small;
+    BigInteger whole;
+    BigInteger rem;
+    BigInteger denom;
+    unsigned long long rem64;
+    unsigned long long denom64;
+    char chunk[DECIMAL_BLOCK_DIGITS];
+    size_t chunk_pos;
+
+    int refill() {
+        long long block;
+        if (small) {
+            unsigned long long scaled = rem64 * DECIMAL_BLOCK;
+            block = scaled / denom64;
+            rem64 = scaled % denom64;
+        }
+        else {
+            rem.mul_add_short(DECIMAL_BLOCK, 0);
+            block = rem.divmod_short_quotient(denom);
+        }
+        BigInteger::format_block(chunk, block, true);
+        chunk_pos = 0;
+        return 0;
+    }
+};
+
+// Rounds half up on the exact value, digit by digit from the expansion.
+std::string Rational::asDecimal(size_t precision) const {
+    DecimalExpansion expansion(*this);
+    std::string frac(precision + 1, '0');
+    expansion.digits(&frac[0], precision + 1);
+    BigInteger whole = expansion.integer_part();
+    bool round_up = frac[precision] >= '5';
+    frac.pop_back();
+    if (round_up) {
+        size_t i = precision;
+        for (; i > 0 && frac[i - 1] == '9'; i--) {
+            frac[i - 1] = '0';
+        }
+        if (i > 0) frac[i - 1]++;
+        else whole.mul_add_short(1, 1);
+    }
+    std::string s;
+    if (expansion.negative()) s.push_back('-');
+    whole.append_decimal(s);
+    if (precision != 0) {
+        s += '.';
+        s += frac;
+    }
+    if (s == "-0") s = "0";
+    return s;
+}
+
+Rational operator+(const Rational &a, const Rational &b) {
+    Rational ret = a;
+    ret += b;
+    return ret;
+}
+
+Rational operator-(const Rational &a, const Rational &b) {
+    Rational ret = a;
+    ret -= b;
+    return ret;
+}
+
+Rational operator*(const Rational &a, const Rational &b) {
+    Rational ret = a;
+    ret *= b;
+    return ret;
+}
+
+Rational operator/(const Rational &a, const Rational &b) {
+    Rational ret = a;
+    ret /= b;
+    return ret;
+}
+
+Rational operator-(const Rational &a) {
+    Rational ret = a;
+    ret.RationalNeg();
+    return ret;
+}
+
+bool operator==(const Rational &a, const Rational &b) {
+    return (a.numerator == b.numerator && a.denominator == b.denominator);
+}
+
+bool operator!=(const Rational &a, const Rational &b) {
+    return (a.numerator != b.numerator || a.denominator != b.denominator);
+}
+
+bool operator<(const Rational &a, const Rational &b) {
+    BIGINT_MEMORY_OP(MEMORY_RATIONAL);
+    return (a.numerator * b.denominator < b.numerator * a.denominator);
+}
+
+bool operator>(const Rational &a, const Rational &b) {
+    BIGINT_MEMORY_OP(MEMORY_RATIONAL);
+    return (a.numerator * b.denominator > b.numerator * a.denominator);
+}
+
+bool operator<=(const Rational &a, const Rational &b) {
+    BIGINT_MEMORY_OP(MEMORY_RATIONAL);
+    return (a.numerator * b.denominator <= b.numerator * a.denominator);
+}
+
+bool operator>=(const Rational &a, const Rational &b) {
+    BIGINT_MEMORY_OP(MEMORY_RATIONAL);
+    return (a.numerator * b.denominator >= b.numerator * a.denominator);
+}
+
+std::istream& operator>>(std::istream &in, Rational &a) {
+    BigInteger n, d;
+    in >> n >> d;
+    a = Rational(n, d);
+    return in;
+}
+
+std::ostream& operator<<(std::ostream &out, const Rational &a) {
+    std::string s = a.toString();
+    out << s;
+    return out;
+}
+
+// Opt-in expression templates. Wrapping one operand in lazy() turns the
+// surrounding + - * into a tree that is evaluated only on assignment:
+//
+//     r = lazy(a) * b + lazy(c) * d - e;
+//
+// accumulates every term into r's own buffer, products through the fused
+// addmul kernel, so no per-operator temporaries are created. A product of
+// two plain values (c * d) is still evaluated eagerly. Operands that
+// are plain values are read in place; only a parenthesized subexpression
+// used as a factor is evaluated into a temporary. Rationals are summed over
+// a common denominator and reduced once, with the partial products kept in
+// one LazyScratch per evaluation. Nodes keep pointers to their operands, so
+// an expression must be consumed within the full expression that built it.
+template <>
+struct LazyScratch<BigInteger> {};
+
+template <>
+struct LazyScratch<Rational> {
+    BigInteger p, q;
+    BigIntegerWorkspace ws;
+};
+
+struct LazyEval {
+    static int add(BigInteger &acc, const BigInteger &a, bool negative, LazyScratch<BigInteger> &) {
+        return acc.add_limbs(a.body, a.body.size(), a.sign ^ negative);
+    }
+
+    static int addmul(BigInteger &acc, const BigInteger &a, const BigInteger &b, bool negative, LazyScratch<BigInteger> &) {
+        return acc.addmul_limbs(a.body.data(), a.body.size(), b.body.data(), b.body.size(), a.sign ^ b.sign ^ negative);
+    }
+
+    // acc is kept unreduced; p / q need not be reduced either.
+    static int add_fraction(Rational &acc, const BigInteger &p, const BigInteger &q, bool negative, LazyScratch<Rational> &scratch) {
+        BigInteger &num = acc.numerator, &den = acc.denominator;
+        if (q == den) return num.add_limbs(p.body, p.body.size(), p.sign ^ negative);
+        if (q == 1) return num.addmul_limbs(p.body.data(), p.body.size(), den.body.data(), den.body.size(), p.sign ^ den.sign ^ negative);
+        if (den == 1) {
+            num.mul(q, scratch.ws);
+            den = q;
+            return num.add_limbs(p.body, p.body.size(), p.sign ^ negative);
+        }
+        num.mul(q, scratch.ws);
+        num.addmul_limbs(p.body.data(), p.body.size(), den.body.data(), den.body.size(), p.sign ^ den.sign ^ negative);
+        den.mul(q, scratch.ws);
+        return 0;
+    }
+
+    static int add(Rational &acc, const Rational &a, bool negative, LazyScratch<Rational> &scratch) {
+        return add_fraction(acc, a.numerator, a.denominator, negative, scratch);
+    }
+
+    static int addmul(Rational &acc, const Rational &a, const Rational &b, bool negative, LazyScratch<Rational> &scratch) {
+        scratch.p = a.numerator;
+        scratch.p.mul(b.numerator, scratch.ws);
+        scratch.q = a.denominator;
+        scratch.q.mul(b.denominator, scratch.ws);
+        return add_fraction(acc, scratch.p, scratch.q, negative, scratch);
+    }
+};
+
+template <typename T>
+class LazyTerm {
+public:
+    typedef T value_type;
+
+    explicit LazyTerm(const T &v) : value(&v) {}
+
+    const T& get() const {
+        return *value;
+    }
+
+    bool aliases(const T *p) const {
+        return value == p;
+    }
+
+    int accumulate(T &acc, bool negative, LazyScratch<T> &scratch) const {
+        return LazyEval::add(acc, *value, negative, scratch);
+    }
+
+private:
+    const T *value;
+};
+
+// A factor of a product: a LazyTerm is passed through by reference, any
+// other node is evaluated into a temporary first.
+template <typename E>
+class LazyOperand {
+public:
+    explicit LazyOperand(const E &e) : value(e) {}
+
+    const typename E::value_type& get() const {
+        return value;
+    }
+
+private:
+    typename E::value_type value;
+};
+
+template <typename T>
+class LazyOperand<LazyTerm<T> > {
+public:
+    explicit LazyOperand(const LazyTerm<T> &e) : value(e.get()) {}
+
+    const T& get() const {
+        return value;
+    }
+
+private:
+    const T &value;
+};
+
+template <typename L, typename R>
+class LazyProduct {
+    static_assert(std::is_same<typename L::value_type, typename R::value_type>::value, "lazy operands must have the same type");
+
+public:
+    typedef typename L::value_type value_type;
+
+    LazyProduct(const L &l, const R &r) : left(l), right(r) {}
+
+    bool aliases(const value_type *p) const {
+        return left.aliases(p) || right.aliases(p);
+    }
+
+    int accumulate(value_type &acc, bool negative, LazyScratch<value_type> &scratch) const {
+        LazyOperand<L> l(left);
+        LazyOperand<R> r(right);
+        return LazyEval::addmul(acc, l.get(), r.get(), negative, scratch);
+    }
+
+private:
+    L left;
+    R right;
+};
+
+template <typename L, typename R, bool Subtract>
+class LazySum {
+    static_assert(std::is_same<typename L::value_type, typename R::value_type>::value, "lazy operands must have the same type");
+
+public:
+    typedef typename L::value_type value_type;
+
+    LazySum(const L &l, const R &r) : left(l), right(r) {}
+
+    bool aliases(const value_type *p) const {
+        return left.aliases(p) || right.aliases(p);
+    }
+
+    int accumulate(value_type &acc, bool negative, LazyScratch<value_type> &scratch) const {
+        left.accumulate(acc, negative, scratch);
+        return right.accumulate(acc, negative ^ Subtract, scratch);
+    }
+
+private:
+    L left;
+    R right;
+};
+
+template <typename E>
+class LazyNegate {
+public:
+    typedef typename E::value_type value_type;
+
+    explicit LazyNegate(const E &e) : inner(e) {}
+
+    bool aliases(const value_type *p) const {
+        return inner.aliases(p);
+    }
+
+    int accumulate(value_type &acc, bool negative, LazyScratch<value_type> &scratch) const {
+        return inner.accumulate(acc, !negative, scratch);
+    }
+
+private:
+    E inner;
+};
+
+// Maps an operand to its node type: values become LazyTerm, nodes stay
+// as they are. Anything else has no mapping, which keeps the operators
+// below out of overload resolution.
+template <typename T>
+struct LazyNode {};
+
+template <typename T>
+struct LazyValueNode {
+    typedef LazyTerm<T> type;
+    static const bool expression = false;
+
+    static type wrap(const T &v) {
+        return type(v);
+    }
+};
+
+template <typename T>
+struct LazyExpressionNode {
+    typedef T type;
+    static const bool expression = true;
+
+    static const T& wrap(const T &e) {
+        return e;
+    }
+};
+
+template <> struct LazyNode<BigInteger> : LazyValueNode<BigInteger> {};
+template <> struct LazyNode<Rational> : LazyValueNode<Rational> {};
+template <typename T> struct LazyNode<LazyTerm<T> > : LazyExpressionNode<LazyTerm<T> > {};
+template <typename L, typename R> struct LazyNode<LazyProduct<L, R> > : LazyExpressionNode<LazyProduct<L, R> > {};
+template <typename L, typename R, bool S> struct LazyNode<LazySum<L, R, S> > : LazyExpressionNode<LazySum<L, R, S> > {};
+template <typename E> struct LazyNode<LazyNegate<E> > : LazyExpressionNode<LazyNegate<E> > {};
+
+inline LazyTerm<BigInteger> lazy(const BigInteger &v) {
+    return LazyTerm<BigInteger>(v);
+}
+
+inline LazyTerm<Rational> lazy(const Rational &v) {
+    return LazyTerm<Rational>(v);
+}
+
+template <typename L, typename R>
+typename std::enable_if<LazyNode<L>::expression || LazyNode<R>::expression,
+                        LazySum<typename LazyNode<L>::type, typename LazyNode<R>::type, false> >::type
+operator+(const L &a, const R &b) {
+    return LazySum<typename LazyNode<L>::type, typename LazyNode<R>::type, false>(LazyNode<L>::wrap(a), LazyNode<R>::wrap(b));
+}
+
+template <typename L, typename R>
+typename std::enable_if<LazyNode<L>::expression || LazyNode<R>::expression,
+                        LazySum<typename LazyNode<L>::type, typename LazyNode<R>::type, true> >::type
+operator-(const L &a, const R &b) {
+    return LazySum<typename LazyNode<L>::type, typename LazyNode<R>::type, true>(LazyNode<L>::wrap(a), LazyNode<R>::wrap(b));
+}
+
+template <typename L, typename R>
+typename std::enable_if<LazyNode<L>::expression || LazyNode<R>::expression,
+                        LazyProduct<typename LazyNode<L>::type, typename LazyNode<R>::type> >::type
+operator*(const L &a, const R &b) {
+    return LazyProduct<typename LazyNode<L>::type, typename LazyNode<R>::type>(LazyNode<L>::wrap(a), LazyNode<R>::wrap(b));
+}
+
+template <typename E>
+typename std::enable_if<LazyNode<E>::expression, LazyNegate<E> >::type
+operator-(const E &e) {
+    return LazyNegate<E>(e);
+}
+
+// Rational that defers reduce(): + - * / leave the fraction unreduced until
+// its limb count has doubled since the last reduction, so the gcd work is
+// amortized over many steps. reduced() brings *this to the canonical form
+// and is the only member besides the arithmetic that modifies it;
+// toString and asDecimal reduce a copy, and comparisons use cross
+// products, so const access from several threads is safe.
+class UnreducedRational {
+public:
+    UnreducedRational() : reduced_flag(true), limit(REDUCE_LIMBS) {}
+    UnreducedRational(const Rational &r) : value(r), reduced_flag(true), limit(REDUCE_LIMBS) {}
+    UnreducedRational(const BigInteger &a) : value(a), reduced_flag(true), limit(REDUCE_LIMBS) {}
+    UnreducedRational(long long a) : value(a), reduced_flag(true), limit(REDUCE_LIMBS) {}
+
+    UnreducedRational& operator+=(const UnreducedRational &b) {
+        static thread_local LazyScratch<Rational> scratch;
+        LazyEval::add(value, b.value, false, scratch);
+        return settle();
+    }
+
+    UnreducedRational& operator-=(const UnreducedRational &b) {
+        static thread_local LazyScratch<Rational> scratch;
+        LazyEval::add(value, b.value, true, scratch);
+        return settle();
+    }
+
+    UnreducedRational& operator*=(const UnreducedRational &b) {
+        value.numerator *= b.value.numerator;
+        value.denominator *= b.value.denominator;
+        return settle();
+    }
+
+    UnreducedRational& operator/=(const UnreducedRational &b) {
+        value.numerator *= b.value.denominator;
+        value.denominator *= b.value.numerator;
+        if (value.denominator < 0) {
+            value.numerator.BigIntegerNeg();
+            value.denominator.BigIntegerNeg();
+        }
+        return settle();
+    }
+
+    const Rational& reduced() {
+        if (!reduced_flag) {
+            value.reduce();
+            reduced_flag = true;
+            limit = 2 * limbs();
+            if (limit < REDUCE_LIMBS) limit = REDUCE_LIMBS;
+        }
+        return value;
+    }
+
+    std::string toString() const {
+        return reduced_flag ? value.toString() : reduced_copy().toString();
+    }
+
+    std::string asDecimal(size_t precision=0) const {
+        return reduced_flag ? value.asDecimal(precision) : reduced_copy().asDecimal(precision);
+    }
+
+    explicit operator double() const {
+        return (double)value;
+    }
+
+    int compare(const UnreducedRational &b) const {
+        BigInteger lhs = value.numerator * b.value.denominator;
+        BigInteger rhs = b.value.numerator * value.denominator;
+        return lhs.BigIntegerCompare(rhs);
+    }
+
+private:
+    // Below this many limbs a reduction is not worth postponing.
+    static const size_t REDUCE_LIMBS = 16;
+
+    Rational value;
+    bool reduced_flag;
+    size_t limit;
+
+    Rational reduced_copy() const {
+        Rational ret = value;
+        ret.reduce();
+        return ret;
+    }
+
+    size_t limbs() const {
+        return value.numerator.body.size() + value.denominator.body.size();
     }
 
-    BigInteger& operator%=(const BigInteger &divider) {
-        BigInteger rem, divcp = divider;
-        (*this).div(divcp, rem);
-        (*this) = rem;
+    UnreducedRational& settle() {
+        reduced_flag = false;
+        if (limbs() > limit) reduced();
         return (*this);
     }
+};
 
-    BigInteger& operator++() {
-        (*this) += 1;
+UnreducedRational operator+(const UnreducedRational &a, const UnreducedRational &b) {
+    UnreducedRational ret = a;
+    ret += b;
+    return ret;
+}
+
+UnreducedRational operator-(const UnreducedRational &a, const UnreducedRational &b) {
+    UnreducedRational ret = a;
+    ret -= b;
+    return ret;
+}
+
+UnreducedRational operator*(const UnreducedRational &a, const UnreducedRational &b) {
+    UnreducedRational ret = a;
+    ret *= b;
+    return ret;
+}
+
+UnreducedRational operator/(const UnreducedRational &a, const UnreducedRational &b) {
+    UnreducedRational ret = a;
+    ret /= b;
+    return ret;
+}
+
+bool operator==(const UnreducedRational &a, const UnreducedRational &b) {
+    return a.compare(b) == 0;
+}
+
+bool operator!=(const UnreducedRational &a, const UnreducedRational &b) {
+    return a.compare(b) != 0;
+}
+
+bool operator<(const UnreducedRational &a, const UnreducedRational &b) {
+    return a.compare(b) < 0;
+}
+
+bool operator>(const UnreducedRational &a, const UnreducedRational &b) {
+    return a.compare(b) > 0;
+}
+
+bool operator<=(const UnreducedRational &a, const UnreducedRational &b) {
+    return a.compare(b) <= 0;
+}
+
+bool operator>=(const UnreducedRational &a, const UnreducedRational &b) {
+    return a.compare(b) >= 0;
+}
+
+std::ostream& operator<<(std::ostream &out, const UnreducedRational &a) {
+    out << a.toString();
+    return out;
+}
+
+// acc += a * b and acc -= a * b without a product temporary: when the
+// product has the sign of acc it is accumulated in place.
+int addmul(BigInteger &acc, const BigInteger &a, const BigInteger &b) {
+    return acc.addmul_limbs(a.body.data(), a.body.size(), b.body.data(), b.body.size(), a.sign ^ b.sign);
+}
+
+int submul(BigInteger &acc, const BigInteger &a, const BigInteger &b) {
+    return acc.addmul_limbs(a.body.data(), a.body.size(), b.body.data(), b.body.size(), !(a.sign ^ b.sign));
+}
+
+int addmul_short(BigInteger &acc, const BigInteger &a, int mult) {
+    unsigned int rest = mult < 0 ? 0U - (unsigned int)mult : mult;
+    int limbs[3] = {0, 0, 0};
+    size_t size = 0;
+    do {
+        limbs[size++] = rest & (RADIX - 1);
+        rest >>= RADIX_BITS;
+    } while (rest);
+    return acc.addmul_limbs(a.body.data(), a.body.size(), limbs, size, a.sign ^ (mult < 0));
+}
+
+BigInteger dot(const BigInteger *a, const BigInteger *b, size_t count) {
+    return BigInteger::dot_limbs(a, b, count);
+}
+
+BigInteger dot(const std::vector<BigInteger> &a, const std::vector<BigInteger> &b) {
+    if (a.size() != b.size()) throw std::invalid_argument("dot: length mismatch");
+    return dot(a.data(), b.data(), a.size());
+}
+
+// Running sum kept in a redundant form: each int column may hold any
+// signed value, so adding a BigInteger is a single carry-free pass over its
+// limbs. Fresh columns stay below RADIX, leaving 31 - RADIX_BITS headroom
+// bits, and carries are propagated only when that headroom is used up or
+// the value is read.
+class BigAccumulator {
+public:
+    BigAccumulator() : pending(0) {}
+
+    explicit BigAccumulator(const BigInteger &init) : pending(0) {
+        (*this) += init;
+    }
+
+    BigAccumulator& operator+=(const BigInteger &b) {
+        add(b, b.sign);
         return (*this);
     }
 
-    BigInteger& operator--() {
-        (*this) -= 1;
+    BigAccumulator& operator-=(const BigInteger &b) {
+        add(b, !b.sign);
         return (*this);
     }
 
-    BigInteger operator++(int) {
-        BigInteger tmp = (*this);
-        (*this) += 1;
-        return tmp;
+    BigInteger value() {
+        normalize();
+        if (cols.empty()) return BigInteger();
+        BigInteger ret(cols.back());
+        if (!ret.is_zero()) ret.shift_left(cols.size() - 1);
+        size_t low = cols.size() - 1;
+        while (low > 0 && cols[low - 1] == 0) low--;
+        if (low > 0) ret.add_limbs(cols, low, false);
+        return ret;
     }
 
-    BigInteger operator--(int) {
-        BigInteger tmp = (*this);
-        (*this) -= 1;
-        return tmp;
+    std::string toString() {
+        return value().toString();
     }
 
-    explicit operator bool() {
-        return this->is_zero() ? false : true; 
+    int clear() {
+        cols.clear();
+        pending = 0;
+        return 0;
     }
 
-    int BigIntegerNeg() {
-        if (!this->is_zero()) sign ^= 1;
+private:
+    // Adds each of magnitude below RADIX, so this many fit in 31 bits on
+    // top of normalized columns.
+    static const int HEADROOM = (1 << (31 - RADIX_BITS)) - 1;
+
+    LimbVector cols;
+    int pending;
+
+    int add(const BigInteger &b, bool negative) {
+        if (pending == HEADROOM) normalize();
+        pending++;
+        if (cols.size() < b.body.size()) cols.resize(b.body.size(), 0);
+        int *out = cols.data();
+        const int *in = b.body.data();
+        size_t size = b.body.size();
+        if (negative) {
+            for (size_t i = 0; i < size; i++) out[i] -= in[i];
+        }
+        else {
+            for (size_t i = 0; i < size; i++) out[i] += in[i];
+        }
         return 0;
     }
 
-    bool BigIntegerSign() {
-        return sign;
+    // Brings every column but the top into [0, RADIX); the top one keeps
+    // the sign and stays within (-RADIX, RADIX).
+    int normalize() {
+        pending = 0;
+        if (cols.empty()) return 0;
+        long long carry = 0;
+        for (size_t i = 0; i + 1 < cols.size(); i++) {
+            long long cur = cols[i] + carry;
+            cols[i] = cur & (RADIX - 1);
+            carry = cur >> RADIX_BITS;
+        }
+        long long top = cols.back() + carry;
+        while (top >= RADIX || top <= -RADIX) {
+            cols.back() = top & (RADIX - 1);
+            top >>= RADIX_BITS;
+            cols.push_back(0);
+        }
+        cols.back() = top;
+        while (cols.size() > 1 && cols.back() == 0) cols.pop_back();
+        return 0;
     }
+};
 
-    int BigIntegerCompare(const BigInteger &b) const {
-        if (this->is_zero() && b.is_zero()) return 0;
-        if (sign ^ b.sign) {
-            if (sign) {
-                return -1;
-            }
-            else {
-                return 1;
-            }
+// Array container: "BIGN", version byte, SERIAL_KIND byte, two zero bytes,
+// u64 LE element count, then the element records back to back.
+template <typename T>
+size_t serialize(const T *values, size_t count, std::vector<unsigned char> &out, bool varint = false) {
+    size_t start = out.size();
+    out.push_back('B');
+    out.push_back('I');
+    out.push_back('G');
+    out.push_back('N');
+    out.push_back(SERIAL_VERSION);
+    out.push_back(T::SERIAL_KIND);
+    out.push_back(0);
+    out.push_back(0);
+    for (int i = 0; i < 8; i++) {
+        out.push_back(((unsigned long long)count >> (8 * i)) & 0xff);
+    }
+    for (size_t i = 0; i < count; i++) {
+        values[i].serialize(out, varint);
+    }
+    return out.size() - start;
+}
+
+template <typename T>
+size_t serialize(const std::vector<T> &values, std::vector<unsigned char> &out, bool varint = false) {
+    return serialize(values.data(), values.size(), out, varint);
+}
+
+// Appends the decoded elements to values; returns the bytes consumed or 0
+// if the buffer is malformed, in which case values is restored.
+template <typename T>
+size_t deserialize(std::vector<T> &values, const unsigned char *data, size_t size) {
+    if (size < SERIAL_ARRAY_HEADER || data[0] != 'B' || data[1] != 'I' || data[2] != 'G' || data[3] != 'N') return 0;
+    if (data[4] != SERIAL_VERSION || data[5] != T::SERIAL_KIND || data[6] || data[7]) return 0;
+    unsigned long long count = 0;
+    for (int i = 0; i < 8; i++) {
+        count |= (unsigned long long)data[8 + i] << (8 * i);
+    }
+    size_t before = values.size();
+    size_t pos = SERIAL_ARRAY_HEADER;
+    for (unsigned long long i = 0; i < count; i++) {
+        T value;
+        size_t len = value.deserialize(data + pos, size - pos);
+        if (len == 0) {
+            values.resize(before);
+            return 0;
         }
-        if (sign) {
-            if (body.size() > b.body.size()) {
-                return -1;
-            }
-            else if (body.size() < b.body.size()) {
-                return 1;
+        values.push_back(value);
+        pos += len;
+    }
+    return pos;
+}
+
+unsigned int worker_count(unsigned int threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+// Runs job(0) .. job(threads - 1) on their own threads, or job(0) on the
+// calling thread when threads is 1.
+template <typename Job>
+void run_workers(unsigned int threads, Job job) {
+    if (threads == 1) {
+        job(0u);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threads; t++) {
+        workers.emplace_back(job, t);
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+// Parses one integer per non-blank line of [data, data + size) and appends
+// them to out in order. The range is split at line boundaries and parsed
+// by up to threads workers, one per 64 KiB of input, directly into their
+// final slots. Returns -1 and leaves out unchanged if a line does not hold
+// exactly one integer.
+int read_lines(const char *data, size_t size, std::vector<BigInteger> &out, unsigned int threads = 0) {
+    const size_t min_chunk = 1 << 16;
+    threads = worker_count(threads);
+    if (threads > size / min_chunk + 1) threads = size / min_chunk + 1;
+    std::vector<size_t> cuts(threads + 1, size);
+    cuts[0] = 0;
+    for (unsigned int t = 1; t < threads; t++) {
+        size_t cut = size / threads * t;
+        if (cut < cuts[t - 1]) cut = cuts[t - 1];
+        while (cut > 0 && cut < size && data[cut - 1] != '\n') cut++;
+        cuts[t] = cut;
+    }
+    std::vector<size_t> offsets(threads + 1, 0);
+    std::vector<int> status(threads, 0);
+    run_workers(threads, [&](unsigned int t) {
+        size_t lines = 0;
+        bool blank = true;
+        for (size_t i = cuts[t]; i < cuts[t + 1]; i++) {
+            if (data[i] == '\n') {
+                lines += !blank;
+                blank = true;
             }
-            else {
-                for (size_t i = body.size(); i > 0; i--) {
-                    if (body[i - 1] > b.body[i - 1]){
-                        return -1;
-                    }
-                    else if (body[i - 1] < b.body[i - 1]) {
-                        return 1;
-                    }
-                }
-                return 0;
+            else if (!isspace((unsigned char)data[i])) {
+                blank = false;
             }
         }
-        if (body.size() > b.body.size()) {
-            return 1;
+        offsets[t + 1] = lines + !blank;
+    });
+    for (unsigned int t = 0; t < threads; t++) {
+        offsets[t + 1] += offsets[t];
+    }
+    size_t before = out.size();
+    out.resize(before + offsets[threads]);
+    run_workers(threads, [&](unsigned int t) {
+        BigIntegerReader reader(data + cuts[t], cuts[t + 1] - cuts[t]);
+        size_t index = before + offsets[t];
+        BigInteger extra;
+        for (; index < before + offsets[t + 1]; index++) {
+            if (!reader.read(out[index])) break;
         }
-        else if (body.size() < b.body.size()) {
+        if (index != before + offsets[t + 1] || reader.read(extra) || reader.fail()) status[t] = -1;
+    });
+    for (unsigned int t = 0; t < threads; t++) {
+        if (status[t] != 0) {
+            out.resize(before);
             return -1;
         }
-        else {
-            for (size_t i = body.size(); i > 0; i--) {
-                if (body[i - 1] > b.body[i - 1]) {
-                    return 1;
-                }
-                else if (body[i - 1] < b.body[i - 1]) {
-                    return -1;
-                }
+    }
+    return 0;
+}
+
+// Writes one integer per line. Batches are formatted by up to threads
+// workers into reusable per-worker buffers and written out in order.
+int write_lines(std::ostream &out, const BigInteger *values, size_t count, unsigned int threads = 0) {
+    const size_t per_worker = 4096;
+    threads = worker_count(threads);
+    if (threads > (count + per_worker - 1) / per_worker) threads = (count + per_worker - 1) / per_worker;
+    std::vector<std::string> text(threads);
+    for (size_t start = 0; start < count; start += per_worker * threads) {
+        run_workers(threads, [&](unsigned int t) {
+            size_t begin = start + t * per_worker;
+            size_t end = begin + per_worker < count ? begin + per_worker : count;
+            text[t].clear();
+            for (size_t i = begin; i < end; i++) {
+                values[i].append_decimal(text[t]);
+                text[t].push_back('\n');
             }
-            return 0;
+        });
+        for (unsigned int t = 0; t < threads; t++) {
+            out.write(text[t].data(), text[t].size());
         }
     }
+    return 0;
+}
 
-    std::string toString() const { 
-        if (this->is_zero()) {
-            std::string out = "0";
-            return out;
-        }
-        BigInteger copy = (*this);
-        int a = 0; int &rem = a;
-        std::string out;
-        size_t index = 0;
-        while (copy.body[0] > 0 || copy.body.size() > 1) {
-            copy.div_short(10, rem);
-            out.push_back(DIGITS[rem]);
-            index++;
-        }
-        if (sign) out.push_back('-');
-        reverse(out);
-        return out;
+// Elementwise and aggregate Rational arithmetic over arrays, split into
+// contiguous chunks over up to threads workers (0 means one per hardware
+// thread). Each worker owns its scratch integers and BigIntegerWorkspace,
+// created on its own thread, so workers share no BigInteger state; the
+// cross products, the gcd and the fold partials live in buffers that are
+// reused across elements, so once they have grown to the operand size
+// only a result that outgrows its own storage allocates. out may be a or b
+// but must not partially overlap them. An exception on a worker is
+// rethrown on the calling thread once all workers have finished.
+class RationalBatch {
+public:
+    static int add(Rational *out, const Rational *a, const Rational *b, size_t count, unsigned int threads = 0) {
+        return elementwise(out, a, b, count, BATCH_ADD, threads);
     }
-    int mul(int mult) {
-        mul_short(mult);
-        return 0;
+
+    static int mul(Rational *out, const Rational *a, const Rational *b, size_t count, unsigned int threads = 0) {
+        return elementwise(out, a, b, count, BATCH_MUL, threads);
     }
 
-    int abs() {
-        sign = 0;
+    static int div(Rational *out, const Rational *a, const Rational *b, size_t count, unsigned int threads = 0) {
+        return elementwise(out, a, b, count, BATCH_DIV, threads);
+    }
+
+    static int reduce(Rational *values, size_t count, unsigned int threads = 0) {
+        parallel_for(count, threads, MIN_CHUNK, [&](size_t begin, size_t end, Scratch &s) {
+            for (size_t i = begin; i < end; i++) {
+                values[i].reduce(s.ws, s.term);
+            }
+        });
         return 0;
     }
 
-    bool is_zero() const {
-        return body.size() == 1 && body[0] == 0;
+    // Each worker folds its chunk pairwise, then the partials are combined
+    // in a balanced tree, level by level in parallel, so the operands of
+    // every addition or multiplication stay of similar size.
+    static Rational sum(const Rational *values, size_t count, unsigned int threads = 0) {
+        return aggregate(values, count, BATCH_ADD, threads);
+    }
+
+    static Rational product(const Rational *values, size_t count, unsigned int threads = 0) {
+        return aggregate(values, count, BATCH_MUL, threads);
     }
 
 private:
-    bool sign;
-    std::vector <int> body;  
-    
-    int shift_left(size_t k) {
-        if (k == 0) return 0;
-        body.resize(body.size() + k);
-        for (size_t i = 0; i < k; i++) {
-            body[body.size() - k + i] = 0;
+    enum Op { BATCH_ADD, BATCH_MUL, BATCH_DIV };
+
+    static const size_t MIN_CHUNK = 64;
+
+    struct Scratch {
+        BigIntegerWorkspace ws;
+        BigInteger numerator;
+        BigInteger denominator;
+        BigInteger term;
+    };
+
+    template <typename Body>
+    static void parallel_for(size_t count, unsigned int threads, size_t min_chunk, Body body) {
+        threads = worker_count(threads);
+        size_t most = (count + min_chunk - 1) / min_chunk;
+        if (threads > most) threads = most;
+        if (threads <= 1) {
+            Scratch s;
+            body(0, count, s);
+            return;
         }
-        for (size_t i = body.size(); i > k; i--) {
-            body[i - 1] = body[i - 1 - k];
-            body[i - 1 - k] = 0;
+        size_t chunk = (count + threads - 1) / threads;
+        std::vector<std::exception_ptr> errors(threads);
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threads; t++) {
+            size_t begin = t * chunk;
+            if (begin >= count) break;
+            size_t end = begin + chunk < count ? begin + chunk : count;
+            workers.emplace_back([&, t, begin, end]() {
+                try {
+                    Scratch s;
+                    body(begin, end, s);
+                }
+                catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+        for (size_t t = 0; t < errors.size(); t++) {
+            if (errors[t]) std::rethrow_exception(errors[t]);
+        }
+    }
+
+    // out = a op b with the cross products formed in s; out may alias a or b.
+    static int combine(Rational &out, const Rational &a, const Rational &b, Op op, Scratch &s) {
+        s.numerator = a.numerator;
+        s.denominator = a.denominator;
+        if (op == BATCH_ADD) {
+            s.numerator.mul(b.denominator, s.ws);
+            s.term = b.numerator;
+            s.term.mul(a.denominator, s.ws);
+            s.numerator.add_limbs(s.term.body, s.term.body.size(), s.term.sign);
+            s.denominator.mul(b.denominator, s.ws);
+        }
+        else if (op == BATCH_MUL) {
+            s.numerator.mul(b.numerator, s.ws);
+            s.denominator.mul(b.denominator, s.ws);
+        }
+        else {
+            s.numerator.mul(b.denominator, s.ws);
+            s.denominator.mul(b.numerator, s.ws);
+            if (s.denominator < 0) {
+                s.numerator.BigIntegerNeg();
+                s.denominator.BigIntegerNeg();
+            }
         }
+        out.numerator = s.numerator;
+        out.denominator = s.denominator;
+        return out.reduce(s.ws, s.term);
+    }
+
+    static int elementwise(Rational *out, const Rational *a, const Rational *b, size_t count, Op op, unsigned int threads) {
+        parallel_for(count, threads, MIN_CHUNK, [&](size_t begin, size_t end, Scratch &s) {
+            for (size_t i = begin; i < end; i++) {
+                combine(out[i], a[i], b[i], op, s);
+            }
+        });
         return 0;
     }
 
-    int search_mult(const BigInteger &divider) {
-        int l = 0, r = RADIX;
-        while (l + 1 < r) {
-            int m = (l + r) / 2;
-            BigInteger prod = divider; 
-            prod.mul_short(m); 
-            int code = prod.BigIntegerCompare((*this));
-            if (code == -1) {
-                l = m;
+    // Folds like a binary counter: a partial is merged with the one below
+    // it once both cover the same number of values, so at most log2(count)
+    // partials are live. Merged slots are kept rather than popped, so a
+    // slot's buffers are reused by the next partial at that depth.
+    static Rational fold(const Rational *values, size_t count, Op op, Scratch &s) {
+        std::vector<Rational> partials;
+        std::vector<size_t> heights;
+        size_t live = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (live == partials.size()) {
+                partials.push_back(values[i]);
+                heights.push_back(0);
             }
-            else if (code == 0) {
-                return m;
+            else {
+                partials[live] = values[i];
+                heights[live] = 0;
             }
-            else if (code == 1){
-                r = m;
+            live++;
+            while (live > 1 && heights[live - 1] == heights[live - 2]) {
+                Rational &below = partials[live - 2];
+                combine(below, below, partials[live - 1], op, s);
+                heights[live - 2]++;
+                live--;
             }
         }
-        BigInteger prod = divider; 
-        prod.mul_short(r); 
-        int ret = prod > (*this) ? l : r;
+        if (live == 0) return Rational(op == BATCH_MUL ? 1 : 0);
+        Rational ret = partials[live - 1];
+        for (size_t i = live - 1; i > 0; i--) {
+            combine(ret, partials[i - 1], ret, op, s);
+        }
         return ret;
     }
 
-    int mul_short(int mult) {
-        if (this->is_zero()) (*this) = 0;
-        sign ^= -(mult >> 31);
-        mult = mult < 0 ? -mult : mult;
-        int carry = 0;
-        for (size_t i = 0; i < body.size(); i++) {
-            int product = body[i] * mult + carry;
-            body[i] = product % RADIX;
-            carry = product / RADIX;
+    static Rational aggregate(const Rational *values, size_t count, Op op, unsigned int threads) {
+        threads = worker_count(threads);
+        size_t most = (count + MIN_CHUNK - 1) / MIN_CHUNK;
+        size_t parts = threads < most ? threads : most;
+        if (parts <= 1) {
+            Scratch s;
+            return fold(values, count, op, s);
         }
-        if (carry) {
-            body.resize(body.size() + 1);
-            body[body.size() - 1] = carry;
+        size_t chunk = (count + parts - 1) / parts;
+        parts = (count + chunk - 1) / chunk;
+        std::vector<Rational> partials(parts);
+        parallel_for(parts, threads, 1, [&](size_t begin, size_t end, Scratch &s) {
+            for (size_t p = begin; p < end; p++) {
+                size_t first = p * chunk, last = first + chunk < count ? first + chunk : count;
+                partials[p] = fold(values + first, last - first, op, s);
+            }
+        });
+        while (partials.size() > 1) {
+            std::vector<Rational> next((partials.size() + 1) / 2);
+            parallel_for(next.size(), threads, 1, [&](size_t begin, size_t end, Scratch &s) {
+                for (size_t i = begin; i < end; i++) {
+                    if (2 * i + 1 < partials.size()) combine(next[i], partials[2 * i], partials[2 * i + 1], op, s);
+                    else next[i] = partials[2 * i];
+                }
+            });
+            partials.swap(next);
         }
-        return 0;
+        return partials[0];
     }
+};
 
-    int div_short(int div, int &rem) {
-        if (this->is_zero()) (*this) = 0;
-        sign ^= -(div >> 31);
-        div = div < 0 ? -div : div;
-        if (body.size() == 1) {
-            rem = body[0] % div;
-            body[0] /= div;
-            return 0;
+#if __cplusplus >= 201402L
+// Fixed-width two's complement integer: arithmetic wraps modulo 2^Bits,
+// comparison, division and printing read the value as signed. Limbs are
+// 32-bit words in an inline std::array, so nothing touches the heap, and
+// every loop runs over the compile-time LIMBS. The arithmetic is constexpr
+// and usable in constant expressions from C++17 on.
+template <size_t Bits>
+class FixedBigInteger {
+    static_assert(Bits > 0 && Bits % 32 == 0, "FixedBigInteger width must be a positive multiple of 32");
+
+public:
+    static constexpr size_t LIMBS = Bits / 32;
+    typedef std::array<uint32_t, Bits / 32> Limbs;
+
+    constexpr FixedBigInteger() : limbs() {}
+
+    template <typename T, typename = typename std::enable_if<MachineWord<T>::value>::type>
+    constexpr FixedBigInteger(T init) : limbs() {
+        unsigned long long value = (unsigned long long)init;
+        uint32_t fill = init < 0 ? 0xffffffffU : 0;
+        for (size_t i = 0; i < LIMBS; i++) {
+            limbs[i] = i < 2 ? (uint32_t)(value >> (32 * i)) : fill;
         }
-        int curint = 0;
-        for (size_t i = body.size(); i > 0; i--) {
-            curint += body[i - 1];
-            if (curint < div) {
-                body[i - 1] = 0;
-                curint *= RADIX;
-                continue;
+    }
+
+    // Keeps the low Bits bits of b in two's complement.
+    explicit FixedBigInteger(const BigInteger &b) : limbs() {
+        unsigned long long acc = 0;
+        int accbits = 0;
+        size_t index = 0;
+        for (size_t i = 0; i < b.body.size() && index < LIMBS; i++) {
+            acc |= (unsigned long long)b.body[i] << accbits;
+            accbits += RADIX_BITS;
+            if (accbits >= 32) {
+                limbs[index++] = (uint32_t)acc;
+                acc >>= 32;
+                accbits -= 32;
             }
-            body[i - 1] = curint / div;
-            curint %= div;
-            curint *= RADIX;
-        }
-        curint /= RADIX;
-        rem = curint;
-        size_t ind = 0;
-        while (body[body.size() - ind - 1] == 0 && body.size() - ind - 1 != 0) {
-            ind++;
         }
-        body.resize(body.size() - ind);
-        return 0;
+        if (index < LIMBS) limbs[index] = (uint32_t)acc;
+        if (b.sign) negate();
     }
-    
-    int div(const BigInteger &diver, BigInteger &rem) {
-        if (this->is_zero()) (*this) = 0;
-        BigInteger cur, res, acopy = (*this);
-        int sign_a = sign, sign_div = diver.sign;
-        BigInteger divider = diver; divider.abs();
-        size_t len = body.size();
-        while (cur < divider && cur.body.size() < body.size()) { 
-            if (!cur.is_zero()) cur.shift_left(1); 
-            cur.body[0] = body[len - 1];
-            len--;
-        }
-        for (size_t i = len + 1; i > 0; i--) {
-            if (i != len + 1) cur.body[0] = body[i - 1];
-            if (cur < divider) {
-                if (i == 1) {
-                    res.shift_left(1); 
-                    res.body[0] = 0;
-                    break;
-                }
-                if (!cur.is_zero()) cur.shift_left(1); 
-                res.shift_left(1); 
-                res.body[0] = 0;
-                continue;
+
+    explicit operator BigInteger() const {
+        Limbs mag = magnitude();
+        BigInteger ret;
+        ret.body.clear();
+        unsigned long long acc = 0;
+        int accbits = 0;
+        for (size_t i = 0; i < LIMBS; i++) {
+            acc |= (unsigned long long)mag[i] << accbits;
+            accbits += 32;
+            while (accbits >= RADIX_BITS) {
+                ret.body.push_back(acc & (RADIX - 1));
+                acc >>= RADIX_BITS;
+                accbits -= RADIX_BITS;
             }
-            int mult = cur.search_mult(divider);
-            BigInteger prod = divider; 
-            prod.mul_short(mult); 
-            cur -= prod; 
-            res.shift_left(1); 
-            res.body[0] = mult;
-            if (i > 1 && !cur.is_zero()) cur.shift_left(1); 
-        }
-        (*this) = res; 
-        int diff = 0;
-        while (this->body[this->body.size() - diff - 1] == 0 && this->body.size() - diff > 1) {
-            diff++;
-        } 
-        this->body.resize(this->body.size() - diff);  
-        sign = sign_a ^ sign_div;
-        BigInteger p = diver;
-        p *= (*this);
-        acopy -= p;
-        rem = acopy; 
-        return 0;
-    } 
-};
+        }
+        ret.body.push_back(acc);
+        while (ret.body.size() > 1 && ret.body.back() == 0) ret.body.pop_back();
+        ret.sign = negative();
+        return ret;
+    }
 
-BigInteger operator+(const BigInteger &a, const BigInteger &b) {
-    BigInteger tmp = a;
-    tmp += b;
-    return tmp;
-}
+    constexpr FixedBigInteger& operator+=(const FixedBigInteger &b) {
+        unsigned long long carry = 0;
+        for (size_t i = 0; i < LIMBS; i++) {
+            carry += (unsigned long long)limbs[i] + b.limbs[i];
+            limbs[i] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        return (*this);
+    }
 
-BigInteger operator-(const BigInteger &a, const BigInteger &b) {
-    BigInteger tmp = a;
-    tmp -= b;
-    return tmp;
-}
+    constexpr FixedBigInteger& operator-=(const FixedBigInteger &b) {
+        unsigned long long borrow = 0;
+        for (size_t i = 0; i < LIMBS; i++) {
+            unsigned long long diff = (unsigned long long)limbs[i] - b.limbs[i] - borrow;
+            limbs[i] = (uint32_t)diff;
+            borrow = diff >> 63;
+        }
+        return (*this);
+    }
 
-BigInteger operator*(const BigInteger &a, const BigInteger &b) {
-    BigInteger tmp = a;
-    tmp *= b;
-    return tmp;
-}
+    // Only the low LIMBS limbs of the product are formed.
+    constexpr FixedBigInteger& operator*=(const FixedBigInteger &b) {
+        Limbs res = {};
+        for (size_t i = 0; i < LIMBS; i++) {
+            if (limbs[i] == 0) continue;
+            unsigned long long carry = 0;
+            for (size_t j = 0; i + j < LIMBS; j++) {
+                carry += res[i + j] + (unsigned long long)limbs[i] * b.limbs[j];
+                res[i + j] = (uint32_t)carry;
+                carry >>= 32;
+            }
+        }
+        limbs = res;
+        return (*this);
+    }
 
-BigInteger operator/(const BigInteger &a, const BigInteger &b) {
-    BigInteger tmp = a;
-    tmp /= b;
-    return tmp;
-}
+    // Truncating signed division like BigInteger; MIN / -1 wraps to MIN.
+    constexpr FixedBigInteger& operator/=(const FixedBigInteger &b) {
+        Limbs quot = {}, rem = {};
+        divmod_magnitude(magnitude(), b.magnitude(), quot, rem);
+        bool negative_quot = negative() != b.negative();
+        limbs = quot;
+        if (negative_quot) negate();
+        return (*this);
+    }
 
-BigInteger operator%(const BigInteger &a, const BigInteger &b) {
-    BigInteger tmp = a;
-    tmp %= b;
-    return tmp;
-}
+    constexpr FixedBigInteger& operator%=(const FixedBigInteger &b) {
+        Limbs quot = {}, rem = {};
+        divmod_magnitude(magnitude(), b.magnitude(), quot, rem);
+        bool negative_rem = negative();
+        limbs = rem;
+        if (negative_rem) negate();
+        return (*this);
+    }
 
-BigInteger operator-(const BigInteger &a) {
-    BigInteger ret = a;
-    ret.BigIntegerNeg();
-    return ret;
-}
+    constexpr FixedBigInteger& operator++() {
+        return (*this) += FixedBigInteger(1);
+    }
 
-bool operator==(const BigInteger &a, const BigInteger &b) {
-    int res = a.BigIntegerCompare(b);
-    return res == 0 ? true : false;
-}
+    constexpr FixedBigInteger& operator--() {
+        return (*this) -= FixedBigInteger(1);
+    }
 
-bool operator!=(const BigInteger &a, const BigInteger &b) {
-    int res = a.BigIntegerCompare(b);
-    return res != 0 ? true : false;
-}
+    constexpr FixedBigInteger operator++(int) {
+        FixedBigInteger tmp = (*this);
+        ++(*this);
+        return tmp;
+    }
 
-bool operator<(const BigInteger &a, const BigInteger &b) {
-    int res = a.BigIntegerCompare(b);
-    return res == -1 ? true : false;
-}
+    constexpr FixedBigInteger operator--(int) {
+        FixedBigInteger tmp = (*this);
+        --(*this);
+        return tmp;
+    }
 
-bool operator>(const BigInteger &a, const BigInteger &b) {
-    int res = a.BigIntegerCompare(b);
-    return res == 1 ? true : false;
-}
+    constexpr explicit operator bool() const {
+        return !is_zero();
+    }
 
-bool operator<=(const BigInteger &a, const BigInteger &b) {
-    int res = a.BigIntegerCompare(b);
-    return res != 1 ? true : false;
-}
+    constexpr int BigIntegerNeg() {
+        negate();
+        return 0;
+    }
 
-bool operator>=(const BigInteger &a, const BigInteger &b) {
-    int res = a.BigIntegerCompare(b);
-    return res != -1 ? true : false;
-}
+    constexpr bool BigIntegerSign() const {
+        return negative();
+    }
 
-std::istream& operator>>(std::istream &in, BigInteger &a) {
-    std::string s;
-    in >> s;
-    a = BigInteger(s);
-    return in;
-}
+    constexpr int BigIntegerCompare(const FixedBigInteger &b) const {
+        if (negative() != b.negative()) return negative() ? -1 : 1;
+        for (size_t i = LIMBS; i > 0; i--) {
+            if (limbs[i - 1] != b.limbs[i - 1]) return limbs[i - 1] > b.limbs[i - 1] ? 1 : -1;
+        }
+        return 0;
+    }
 
-std::ostream& operator<<(std::ostream &out, const BigInteger &a) {
-    std::string s = a.toString();
-    out << s;
-    return out;
-}
+    constexpr int abs() {
+        if (negative()) negate();
+        return 0;
+    }
 
-std::string& reverse(std::string &s) {
-    for (size_t i = 0; i < s.size() / 2; i++) {
-        std::swap(s[i], s[s.size() - i - 1]);
+    constexpr bool is_zero() const {
+        for (size_t i = 0; i < LIMBS; i++) {
+            if (limbs[i] != 0) return false;
+        }
+        return true;
     }
-    return s;
-}
 
-class Rational {
-public:
-    Rational() {
-        numerator = 0;
-        denominator = 1;
+    constexpr const Limbs& data() const {
+        return limbs;
     }
-    
-    Rational(const BigInteger &a, const BigInteger &b) {
-        numerator = a;
-        denominator = b;
-        if (denominator < 0) {
-            numerator.BigIntegerNeg();
-            denominator.BigIntegerNeg();
+
+    std::string toString() const {
+        Limbs mag = magnitude();
+        std::vector<int> blocks;
+        size_t size = LIMBS;
+        while (size > 1 && mag[size - 1] == 0) size--;
+        do {
+            unsigned long long rem = 0;
+            for (size_t i = size; i > 0; i--) {
+                unsigned long long cur = (rem << 32) | mag[i - 1];
+                mag[i - 1] = cur / DECIMAL_BLOCK;
+                rem = cur % DECIMAL_BLOCK;
+            }
+            while (size > 1 && mag[size - 1] == 0) size--;
+            blocks.push_back(rem);
+        } while (size > 1 || mag[0] > 0);
+        std::string out;
+        if (negative()) out.push_back('-');
+        char digits[DECIMAL_BLOCK_DIGITS];
+        for (size_t i = blocks.size(); i > 0; i--) {
+            out.append(digits, BigInteger::format_block(digits, blocks[i - 1], i != blocks.size()));
         }
-        (*this).reduce();
+        return out;
     }
 
-    Rational(const BigInteger &a) {
-        numerator = a;
-        denominator = 1;
+    friend constexpr FixedBigInteger operator+(FixedBigInteger a, const FixedBigInteger &b) {
+        return a += b;
     }
 
-    Rational(int a) {
-        numerator = a;
-        denominator = 1;
+    friend constexpr FixedBigInteger operator-(FixedBigInteger a, const FixedBigInteger &b) {
+        return a -= b;
     }
 
-    Rational(const Rational &b) {
-        numerator = b.numerator;
-        denominator = b.denominator;
+    friend constexpr FixedBigInteger operator*(FixedBigInteger a, const FixedBigInteger &b) {
+        return a *= b;
     }
 
-    Rational& operator=(const Rational &b) {
-        numerator = b.numerator;
-        denominator = b.denominator;
-        return (*this);
+    friend constexpr FixedBigInteger operator/(FixedBigInteger a, const FixedBigInteger &b) {
+        return a /= b;
     }
 
-    Rational& operator+=(const Rational &b) {
-        numerator = numerator * b.denominator + b.numerator * denominator;
-        denominator *= b.denominator;
-        (*this).reduce();
-        return (*this);
+    friend constexpr FixedBigInteger operator%(FixedBigInteger a, const FixedBigInteger &b) {
+        return a %= b;
     }
 
-    Rational& operator-=(const Rational &b) {
-        numerator = numerator * b.denominator - b.numerator * denominator;
-        denominator *= b.denominator;
-        (*this).reduce();
-        return (*this);
+    friend constexpr FixedBigInteger operator-(FixedBigInteger a) {
+        a.negate();
+        return a;
     }
 
-    Rational& operator*=(const Rational &b) {
-        numerator *= b.numerator;
-        denominator *= b.denominator;
-        (*this).reduce();
-        return (*this);
+    friend constexpr bool operator==(const FixedBigInteger &a, const FixedBigInteger &b) {
+        return a.BigIntegerCompare(b) == 0;
     }
 
-    Rational& operator/=(const Rational &b) {
-        numerator *= b.denominator;
-        denominator *= b.numerator;
-        if (denominator < 0) {
-            numerator.BigIntegerNeg();
-            denominator.BigIntegerNeg();
-        }
-        (*this).reduce();
-        return (*this); 
+    friend constexpr bool operator!=(const FixedBigInteger &a, const FixedBigInteger &b) {
+        return a.BigIntegerCompare(b) != 0;
     }
 
-    std::string toString() const { 
-        std::string s_numer = numerator.toString();
-        if (denominator == 1 || numerator == 0) return s_numer;
-        std::string ret; 
-        std::string s_denom = denominator.toString();
-        ret += s_numer;
-        ret += '/';
-        ret += s_denom;
-        return ret;
+    friend constexpr bool operator<(const FixedBigInteger &a, const FixedBigInteger &b) {
+        return a.BigIntegerCompare(b) < 0;
     }
 
-    int RationalNeg() {
-        numerator.BigIntegerNeg();
-        return 0;
+    friend constexpr bool operator>(const FixedBigInteger &a, const FixedBigInteger &b) {
+        return a.BigIntegerCompare(b) > 0;
     }
 
-    std::string asDecimal(size_t precision=0) {
-        bool keepsign = numerator.BigIntegerSign();
-        BigInteger numer = numerator;
-        numer.abs();
-        if (numer == 0) {
-            std::string s = numer.toString();
-            if (precision != 0) {
-                s += '.'; 
-                std::string fill(precision, '0');
-                s += fill;
-            }
-            return s;
-        }
-        BigInteger ten_pwr = 1;
-        for (size_t i = 0; i <= precision; i++) {
-            ten_pwr *= 10;
-        }
-        numer *= ten_pwr;
-        numer /= denominator;
-        BigInteger last_digit = numer % 10;
-        numer /= 10;
-        if (last_digit >= 5) numer++;
-        std::string s = numer.toString();
-        if (s.size() < precision) {
-            std::string fill(precision - s.size(), '0');
-            s = fill + s;
-        }
-        s.insert(s.size() - precision, ".");
-        if (s[s.size() - 1] == '.') s.pop_back();
-        else if (s[0] == '.') s = '0' + s; 
-        if (keepsign && s != "0") s = '-' + s;
-        return s;
+    friend constexpr bool operator<=(const FixedBigInteger &a, const FixedBigInteger &b) {
+        return a.BigIntegerCompare(b) <= 0;
     }
 
-    explicit operator double() {
-        std::string asdec = this->asDecimal(30);
-        double ret = std::stod(asdec);
-        return ret;
+    friend constexpr bool operator>=(const FixedBigInteger &a, const FixedBigInteger &b) {
+        return a.BigIntegerCompare(b) >= 0;
+    }
+
+    friend std::ostream& operator<<(std::ostream &out, const FixedBigInteger &a) {
+        out << a.toString();
+        return out;
     }
 
-    friend bool operator==(const Rational &a, const Rational &b);
-    friend bool operator!=(const Rational &a, const Rational &b); 
-    friend bool operator>(const Rational &a, const Rational &b);
-    friend bool operator<(const Rational &a, const Rational &b);
-    friend bool operator>=(const Rational &a, const Rational &b);
-    friend bool operator<=(const Rational &a, const Rational &b);
 private:
-    BigInteger numerator;
-    BigInteger denominator;
+    Limbs limbs;
 
-    int reduce() {
-        // if (numerator == 0) return 0;
-        BigInteger numercp = numerator, denomcp = denominator;
-        numercp.abs(), denomcp.abs();
-        while (denomcp > 0) {
-            BigInteger tmp = numercp;
-            numercp = denomcp;
-            denomcp = tmp % denomcp;
+    constexpr bool negative() const {
+        return limbs[LIMBS - 1] >> 31;
+    }
+
+    constexpr void negate() {
+        unsigned long long carry = 1;
+        for (size_t i = 0; i < LIMBS; i++) {
+            carry += (uint32_t)~limbs[i];
+            limbs[i] = (uint32_t)carry;
+            carry >>= 32;
         }
-        numerator /= numercp;
-        denominator /= numercp;
-        return 0;
     }
-};
 
-Rational operator+(const Rational &a, const Rational &b) {
-    Rational ret = a;
-    ret += b;
-    return ret;
-}
+    constexpr Limbs magnitude() const {
+        FixedBigInteger mag = (*this);
+        mag.abs();
+        return mag.limbs;
+    }
 
-Rational operator-(const Rational &a, const Rational &b) {
-    Rational ret = a;
-    ret -= b;
-    return ret;
-}
+    // Knuth's algorithm D on 32-bit limbs; both operands are unsigned.
+    static constexpr void divmod_magnitude(const Limbs &u, const Limbs &v, Limbs &quot, Limbs &rem) {
+        size_t m = LIMBS, n = LIMBS;
+        while (m > 0 && u[m - 1] == 0) m--;
+        while (n > 0 && v[n - 1] == 0) n--;
+        if (n == 0) throw std::domain_error("FixedBigInteger: division by zero");
+        if (m < n) {
+            rem = u;
+            return;
+        }
+        if (n == 1) {
+            unsigned long long r = 0;
+            for (size_t i = m; i > 0; i--) {
+                unsigned long long cur = (r << 32) | u[i - 1];
+                quot[i - 1] = (uint32_t)(cur / v[0]);
+                r = cur % v[0];
+            }
+            rem[0] = (uint32_t)r;
+            return;
+        }
+        int s = 0;
+        while (((v[n - 1] << s) & 0x80000000U) == 0) s++;
+        std::array<uint32_t, Bits / 32 + 1> un = {}, vn = {};
+        for (size_t i = n - 1; i > 0; i--) {
+            vn[i] = (v[i] << s) | (s ? v[i - 1] >> (32 - s) : 0);
+        }
+        vn[0] = v[0] << s;
+        un[m] = s ? u[m - 1] >> (32 - s) : 0;
+        for (size_t i = m - 1; i > 0; i--) {
+            un[i] = (u[i] << s) | (s ? u[i - 1] >> (32 - s) : 0);
+        }
+        un[0] = u[0] << s;
+        for (size_t j = m - n + 1; j > 0; j--) {
+            size_t k = j - 1;
+            unsigned long long num = ((unsigned long long)un[k + n] << 32) | un[k + n - 1];
+            unsigned long long qhat = num / vn[n - 1], rhat = num % vn[n - 1];
+            while (qhat >> 32 || qhat * vn[n - 2] > ((rhat << 32) | un[k + n - 2])) {
+                qhat--;
+                rhat += vn[n - 1];
+                if (rhat >> 32) break;
+            }
+            long long borrow = 0, t = 0;
+            for (size_t i = 0; i < n; i++) {
+                unsigned long long p = qhat * vn[i];
+                t = (long long)un[i + k] - borrow - (long long)(p & 0xffffffffU);
+                un[i + k] = (uint32_t)t;
+                borrow = (long long)(p >> 32) - (t >> 32);
+            }
+            t = (long long)un[k + n] - borrow;
+            un[k + n] = (uint32_t)t;
+            quot[k] = (uint32_t)qhat;
+            if (t < 0) {
+                quot[k]--;
+                unsigned long long carry = 0;
+                for (size_t i = 0; i < n; i++) {
+                    carry += (unsigned long long)un[i + k] + vn[i];
+                    un[i + k] = (uint32_t)carry;
+                    carry >>= 32;
+                }
+                un[k + n] += (uint32_t)carry;
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            rem[i] = (un[i] >> s) | (s ? un[i + 1] << (32 - s) : 0);
+        }
+    }
+};
 
-Rational operator*(const Rational &a, const Rational &b) {
-    Rational ret = a;
-    ret *= b;
-    return ret;
-}
+typedef FixedBigInteger<256> Int256;
+typedef FixedBigInteger<512> Int512;
 
-Rational operator/(const Rational &a, const Rational &b) {
-    Rational ret = a;
-    ret /= b;
-    return ret;
-}
+// Limbs of a decimal literal, worked out during constant evaluation.
+// Digit separators (') are skipped.
+template <size_t N>
+struct BigIntegerLiteralLimbs {
+    int body[N];
+    size_t size;
+};
 
-Rational operator-(const Rational &a) {
-    Rational ret = a;
-    ret.RationalNeg();
+template <size_t N, char... Digits>
+constexpr BigIntegerLiteralLimbs<N> parse_literal_limbs() {
+    BigIntegerLiteralLimbs<N> ret = {{}, 1};
+    const char digits[] = {Digits...};
+    for (size_t d = 0; d < sizeof...(Digits); d++) {
+        if (digits[d] == '\'') continue;
+        int carry = digits[d] - '0';
+        for (size_t i = 0; i < N; i++) {
+            int cur = ret.body[i] * 10 + carry;
+            ret.body[i] = cur & (RADIX - 1);
+            carry = cur >> RADIX_BITS;
+        }
+    }
+    ret.size = N;
+    while (ret.size > 1 && ret.body[ret.size - 1] == 0) ret.size--;
     return ret;
 }
 
-bool operator==(const Rational &a, const Rational &b) {
-    return (a.numerator == b.numerator && a.denominator == b.denominator);
+template <char... Digits>
+constexpr bool literal_is_decimal() {
+    const char digits[] = {Digits...};
+    for (size_t d = 0; d < sizeof...(Digits); d++) {
+        if (digits[d] != '\'' && (digits[d] < '0' || digits[d] > '9')) return false;
+    }
+    return digits[0] != '0' || sizeof...(Digits) == 1;
 }
 
-bool operator!=(const Rational &a, const Rational &b) {
-    return (a.numerator != b.numerator || a.denominator != b.denominator);
-}
+// Value of 123..._bi. The limbs are a constant expression, the BigInteger
+// behind it is built from them once on first use, and conversion to a
+// FixedBigInteger stays inside constant evaluation.
+template <char... Digits>
+class BigIntegerLiteral {
+    static_assert(literal_is_decimal<Digits...>(), "_bi literals must be plain decimal");
 
-bool operator<(const Rational &a, const Rational &b) {
-    return (a.numerator * b.denominator < b.numerator * a.denominator);
-}
+public:
+    // Each digit adds log2(10) < 3322 / 1000 bits, so this many 15-bit
+    // limbs always hold the value.
+    static constexpr size_t CAPACITY = sizeof...(Digits) * 3322 / (RADIX_BITS * 1000) + 1;
+    static constexpr BigIntegerLiteralLimbs<CAPACITY> limbs = parse_literal_limbs<CAPACITY, Digits...>();
 
-bool operator>(const Rational &a, const Rational &b) {
-    return (a.numerator * b.denominator > b.numerator * a.denominator);
-}
+    operator const BigInteger&() const {
+        return value();
+    }
 
-bool operator<=(const Rational &a, const Rational &b) {
-    return (a.numerator * b.denominator <= b.numerator * a.denominator);
-}
+    static const BigInteger& value() {
+        static const BigInteger ret = make();
+        return ret;
+    }
 
-bool operator>=(const Rational &a, const Rational &b) {
-    return (a.numerator * b.denominator >= b.numerator * a.denominator);
-}
+    template <size_t Bits>
+    constexpr operator FixedBigInteger<Bits>() const {
+        FixedBigInteger<Bits> ret;
+        for (size_t i = limbs.size; i > 0; i--) {
+            ret *= RADIX;
+            ret += limbs.body[i - 1];
+        }
+        return ret;
+    }
 
-std::istream& operator>>(std::istream &in, Rational &a) {
-    BigInteger n, d;
-    in >> n >> d;
-    a = Rational(n, d);
-    return in;
-}
+private:
+    static BigInteger make() {
+        BigInteger ret;
+        ret.body.assign(limbs.body, limbs.body + limbs.size);
+        return ret;
+    }
+};
 
-std::ostream& operator<<(std::ostream &out, const Rational &a) {
-    std::string s = a.toString();
-    out << s;
-    return out;
+template <char... Digits>
+constexpr BigIntegerLiteralLimbs<BigIntegerLiteral<Digits...>::CAPACITY> BigIntegerLiteral<Digits...>::limbs;
+
+template <char... Digits>
+constexpr BigIntegerLiteral<Digits...> operator""_bi() {
+    return BigIntegerLiteral<Digits...>();
 }
+#endif
@@ -3,9 +3,18 @@
 
 static const char DIGITS[36] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 static const int RADIX = 1 << 15;
+static const int RADIX_BITS = 15;
+static const int SERIAL_VERSION = 1;
+static const int SERIAL_SIGN = 1;
+static const int SERIAL_VARINT = 2;
+static const size_t SERIAL_HEADER = 8;
+static const size_t SERIAL_ARRAY_HEADER = 16;
+// Smallest record: tag byte, one-byte varint count, one limb.
+static const size_t SERIAL_MIN_RECORD = 4;
+static const int SERIAL_KIND = 1;
 
 enum bn_codes {
-BN_OK, BN_NULL_OBJECT, BN_NO_MEMORY, BN_DIVIDE_BY_ZERO
+BN_OK, BN_NULL_OBJECT, BN_NO_MEMORY, BN_DIVIDE_BY_ZERO, BN_BAD_FORMAT, BN_BAD_ARGUMENT
 };
 
 struct bn_s {
@@ -14,12 +23,91 @@ struct bn_s {
     int sign;
 };
 
+// Limb storage of bn values goes through bn_malloc/bn_realloc/bn_free.
+// With -DBN_MEMORY_STATS every block carries a size header so live blocks,
+// live bytes, the peak and a histogram of block sizes (bucketed by log2 of
+// the size in limbs) can be reported by bn_memory_stats. Unlike
+// BigIntegerMemory in biginteger.h the histogram is not split by
+// operation. The struct bn_s headers and buffers handed to the caller
+// (bn_to_string, bn_export, bn_deserialize_array) stay plain malloc, so
+// only limb buffers are counted.
+// The counters are plain globals, so a BN_MEMORY_STATS build must not call
+// into bn from more than one thread at a time.
+#ifdef BN_MEMORY_STATS
+#define BN_MEMORY_BUCKETS 48
+
+struct bn_memory_stats {
+    size_t live_blocks;
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t histogram[BN_MEMORY_BUCKETS];
+};
+
+static struct bn_memory_stats memory_stats;
+static const size_t MEMORY_HEADER = 16;
+
+static void memory_account(size_t size) {
+    size_t limbs = size / sizeof(int), bucket = 0;
+    while (limbs > 0 && bucket + 1 < BN_MEMORY_BUCKETS) {
+        limbs >>= 1;
+        bucket++;
+    }
+    memory_stats.histogram[bucket]++;
+    if (memory_stats.live_bytes > memory_stats.peak_bytes) memory_stats.peak_bytes = memory_stats.live_bytes;
+}
+
+void *bn_malloc(size_t size) {
+    unsigned char *p = malloc(MEMORY_HEADER + size);
+    if (p == NULL) return NULL;
+    *(size_t*)p = size;
+    memory_stats.live_blocks++;
+    memory_stats.live_bytes += size;
+    memory_account(size);
+    return p + MEMORY_HEADER;
+}
+
+void *bn_realloc(void *ptr, size_t size) {
+    if (ptr == NULL) return bn_malloc(size);
+    unsigned char *p = (unsigned char*)ptr - MEMORY_HEADER;
+    size_t old = *(size_t*)p;
+    p = realloc(p, MEMORY_HEADER + size);
+    if (p == NULL) return NULL;
+    *(size_t*)p = size;
+    memory_stats.live_bytes += size - old;
+    memory_account(size);
+    return p + MEMORY_HEADER;
+}
+
+void bn_free(void *ptr) {
+    if (ptr == NULL) return;
+    unsigned char *p = (unsigned char*)ptr - MEMORY_HEADER;
+    memory_stats.live_blocks--;
+    memory_stats.live_bytes -= *(size_t*)p;
+    free(p);
+}
+
+int bn_memory_stats(struct bn_memory_stats *out) {
+    if (out == NULL) return BN_NULL_OBJECT;
+    *out = memory_stats;
+    return BN_OK;
+}
+
+int bn_memory_reset_peak() {
+    memory_stats.peak_bytes = memory_stats.live_bytes;
+    return BN_OK;
+}
+#else
+#define bn_malloc malloc
+#define bn_realloc realloc
+#define bn_free free
+#endif
+
 int bn_mul_short(bn *t, int int_mult);
 int is_zero(bn const *t);
 int bn_init_string_radix(bn *t, const char *init_string, int radix);
 int match_size(bn *t, int size) {
     if (t == NULL) return BN_NULL_OBJECT;
-    t->body = realloc(t->body, size*sizeof(int));
+    t->body = bn_realloc(t->body, size*sizeof(int));
     if (t->body == NULL) {
         bn_delete(t);
         return BN_NO_MEMORY;
@@ -33,7 +121,7 @@ int match_size(bn *t, int size) {
 
 int expand(bn *t) {
     if (t == NULL) return BN_NULL_OBJECT;
-    int *newbody = malloc(sizeof(int) * (t->bodysize << 1));
+    int *newbody = bn_malloc(sizeof(int) * (t->bodysize << 1));
     if (newbody == NULL) {
         bn_delete(t);
         return BN_NO_MEMORY;
@@ -42,43 +130,17 @@ int expand(bn *t) {
         newbody[i] = t->body[i];
     }
     t->bodysize <<= 1;
-    free(t->body);
+    bn_free(t->body);
     t->body = newbody;
     return BN_OK;
 }
 
-char *expand_string(char *s, size_t *s_cap) {
-    if (s == NULL) return NULL;
-    char *news = malloc(*s_cap << 1);
-    if (news == NULL) {
-        free(s);
-        return NULL;
-    }
-    for (size_t i = 0; i < *s_cap; i++) {
-        news[i] = s[i];
-    }
-    *s_cap <<= 1;
-    free(s);
-    return news;
-}
-
-char *reverse(char *s, size_t slen) {
-    if (s == NULL) return NULL;
-    char *ret = malloc(slen);
-    if (ret == NULL) return NULL;
-    for (size_t i = slen; i > 0; i--) {
-        ret[slen-i] = s[i - 1];
-    }
-    free(s);
-    return ret;
-}
-
 bn *bn_new() {
     bn *r = malloc(sizeof(bn));
     if (r == NULL) return NULL;
     r->bodysize = 1;
     r->sign = 0;
-    r->body = malloc(sizeof(int) * r->bodysize);
+    r->body = bn_malloc(sizeof(int) * r->bodysize);
     if (r->body == NULL) {
         free(r);
         return NULL;
@@ -92,7 +154,7 @@ bn *bn_init(bn const *orig) {
     if (r == NULL) return NULL;
     r->bodysize = orig->bodysize;
     r->sign = orig->sign;
-    r->body = malloc(sizeof(int) * r->bodysize);
+    r->body = bn_malloc(sizeof(int) * r->bodysize);
     if (r->body == NULL) {
         free(r);
         return NULL;
@@ -128,60 +190,83 @@ int bn_init_string(bn *t, const char *init_string) {
     return BN_OK;
 }
 
+int digit_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+int floor_log2(int radix) {
+    int bits = 0;
+    while ((2 << bits) <= radix) bits++;
+    return bits;
+}
+
+// Largest power of radix that stays below 2^31, so that a limb times it
+// fits a long long and whole chunks of digits go through one pass.
+int chunk_digits(int radix, int *chunk_pow) {
+    int chunk = 1;
+    *chunk_pow = radix;
+    while ((long long)*chunk_pow * radix < (1LL << 31)) {
+        *chunk_pow *= radix;
+        chunk++;
+    }
+    return chunk;
+}
+
 int bn_init_string_radix(bn *t, const char *init_string, int radix) {
-    if (t == NULL) return BN_NULL_OBJECT;
-    bn *radix_pow = bn_new();
-    if (radix_pow == NULL) { 
-        bn_delete(t);
-        return BN_NO_MEMORY;
-    }
-    int code = bn_init_int(radix_pow, 1);
-    if (code != BN_OK) {
-        bn_delete(t);
-        bn_delete(radix_pow);
-        return code;
-    }
+    if (t == NULL || init_string == NULL) return BN_NULL_OBJECT;
+    int sign = init_string[0] == '-' ? 1 : 0;
+    const char *digits = init_string + sign;
     size_t size = 0;
-    while (init_string[size] != '\0') size++; 
-    for (size_t i = size; i > 0; i--) {
-        int digit;
-        if (init_string[i - 1] == '-') break;
-        if (init_string[i - 1] >= '0' && init_string[i - 1] <= '9') {
-            digit = init_string[i - 1] - '0';
-        }
-        else digit = init_string[i - 1] - 'A' + 10;
-        bn *prod = bn_init(radix_pow);
-        if (prod == NULL) {
-            bn_delete(prod);
-            bn_delete(radix_pow);
-            bn_delete(t);
-            return BN_NO_MEMORY;
-        }
-        code = bn_mul_short(prod, digit);
-        if (code != BN_OK) {
-            bn_delete(prod);
-            bn_delete(radix_pow);
-            bn_delete(t);
-            return code;
-        }
-        code = bn_add_to(t, prod);
-        if (code != BN_OK) {
-            bn_delete(prod);
-            bn_delete(radix_pow);
-            bn_delete(t);
-            return code;
+    while (digits[size] != '\0') size++;
+    int bits = floor_log2(radix);
+    int power_of_two = (1 << bits) == radix;
+    size_t cap = size * (bits + !power_of_two) / RADIX_BITS + 2;
+    int *body = bn_malloc(sizeof(int) * cap);
+    if (body == NULL) return BN_NO_MEMORY;
+    int bodysize = 0;
+    if (power_of_two) {
+        long long acc = 0;
+        int accbits = 0;
+        for (size_t i = size; i > 0; i--) {
+            acc |= (long long)digit_value(digits[i - 1]) << accbits;
+            accbits += bits;
+            if (accbits >= RADIX_BITS) {
+                body[bodysize++] = acc & (RADIX - 1);
+                acc >>= RADIX_BITS;
+                accbits -= RADIX_BITS;
+            }
         }
-        code = bn_mul_short(radix_pow, radix);
-        if (code != BN_OK) {
-            bn_delete(prod);
-            bn_delete(radix_pow);
-            bn_delete(t);
-            return code;
+        body[bodysize++] = acc;
+    }
+    else {
+        int chunk_pow;
+        size_t chunk = chunk_digits(radix, &chunk_pow);
+        size_t len = size % chunk == 0 ? chunk : size % chunk;
+        body[bodysize++] = 0;
+        for (size_t i = 0; i < size; i += len, len = chunk) {
+            long long mult = 1, carry = 0;
+            for (size_t j = 0; j < len; j++) {
+                carry = carry * radix + digit_value(digits[i + j]);
+                mult *= radix;
+            }
+            for (int k = 0; k < bodysize; k++) {
+                long long cur = body[k] * mult + carry;
+                body[k] = cur & (RADIX - 1);
+                carry = cur >> RADIX_BITS;
+            }
+            while (carry) {
+                body[bodysize++] = carry & (RADIX - 1);
+                carry >>= RADIX_BITS;
+            }
         }
-        bn_delete(prod);
     }
-    t->sign = init_string[0] == '-' ? 1 : 0;
-    bn_delete(radix_pow);
+    while (bodysize > 1 && body[bodysize - 1] == 0) bodysize--;
+    bn_free(t->body);
+    t->body = body;
+    t->bodysize = bodysize;
+    t->sign = is_zero(t) ? 0 : sign;
     return BN_OK;
 }
 
@@ -189,7 +274,7 @@ int bn_copy_to(bn *t, bn *orig) {
     if (t == NULL) return BN_NULL_OBJECT;
     t->sign = orig->sign;
     t->bodysize = orig->bodysize;
-    t->body = realloc(t->body, sizeof(int) * t->bodysize);
+    t->body = bn_realloc(t->body, sizeof(int) * t->bodysize);
     if (t->body == NULL) {
         bn_delete(t);
         return BN_NO_MEMORY;
@@ -202,13 +287,27 @@ int bn_copy_to(bn *t, bn *orig) {
 
 int bn_delete(bn *t) {
     if (t == NULL) return BN_OK;
-    free(t->body);
+    bn_free(t->body);
     t->body = NULL;
     free(t);
     t = NULL;
     return BN_OK;
 }
 
+// Drops leading zero limbs left by earlier operations and returns the
+// spare storage.
+int bn_shrink_to_fit(bn *t) {
+    if (t == NULL) return BN_NULL_OBJECT;
+    int size = t->bodysize;
+    while (size > 1 && t->body[size - 1] == 0) size--;
+    if (size == t->bodysize) return BN_OK;
+    int *body = bn_realloc(t->body, sizeof(int) * size);
+    if (body == NULL) return BN_NO_MEMORY;
+    t->body = body;
+    t->bodysize = size;
+    return BN_OK;
+}
+
 int bn_cmp(bn const *left, bn const *right) {
     if (left == NULL || right == NULL) return BN_NULL_OBJECT;
     if (left->sign ^ right->sign) {
@@ -281,11 +380,18 @@ int is_zero(bn const *t) {
     return t->bodysize == 1 && t->body[0] == 0 ? 1 : 0;
 }
 
+// Length without high zero limbs; bn_mul_to can leave some behind.
+int limb_count(bn const *t) {
+    int size = t->bodysize;
+    while (size > 1 && t->body[size - 1] == 0) size--;
+    return size;
+}
+
 int bn_shift_left(bn *t, size_t k) {
     if (t == NULL) return BN_NULL_OBJECT;
     if (k == 0) return BN_OK;
     t->bodysize += k;
-    t->body = realloc(t->body, t->bodysize * sizeof(int));
+    t->body = bn_realloc(t->body, t->bodysize * sizeof(int));
     if (t->body == NULL) {
         bn_delete(t);
         return BN_NO_MEMORY;
@@ -312,7 +418,7 @@ int bn_mul_short(bn *t, int int_mult) {
     }
     if (carry) {
         t->bodysize++;
-        t->body = realloc(t->body, t->bodysize * sizeof(int));
+        t->body = bn_realloc(t->body, t->bodysize * sizeof(int));
         if (t->body == NULL) {
             bn_delete(t);
             return BN_NO_MEMORY;
@@ -349,7 +455,7 @@ int bn_div_short(bn *t, int int_div, int *int_rem) {
     while (t->body[t->bodysize - 1] == 0 && t->bodysize > 1) {
         t->bodysize--;
     }
-    t->body = realloc(t->body, t->bodysize * sizeof(int));
+    t->body = bn_realloc(t->body, t->bodysize * sizeof(int));
     if (t->body == NULL) {
         bn_delete(t);
         return BN_NO_MEMORY;
@@ -983,45 +1089,407 @@ bn* bn_mod(bn const *left, bn const *right) {
     return ret;   
 }
 
-int bn_pow_to(bn *t, int degree) {
+// Operations with an int operand. The int never becomes a bn: its
+// magnitude is folded into t's limbs in place, so the allocator is only
+// touched when t changes length. Division and remainder round like
+// bn_div_to and bn_mod_to (quotient toward minus infinity, remainder with
+// the sign of the divisor).
+int resize_body(bn *t, int size) {
+    if (size == t->bodysize) return BN_OK;
+    int *body = bn_realloc(t->body, sizeof(int) * size);
+    if (body == NULL) return BN_NO_MEMORY;
+    for (int i = t->bodysize; i < size; i++) {
+        body[i] = 0;
+    }
+    t->body = body;
+    t->bodysize = size;
+    return BN_OK;
+}
+
+int trim_body(bn *t) {
+    int size = limb_count(t);
+    if (size == 1 && t->body[0] == 0) t->sign = 0;
+    return resize_body(t, size);
+}
+
+int set_word(bn *t, long long magnitude, int negative) {
+    int size = 1;
+    for (long long rest = magnitude >> RADIX_BITS; rest > 0; rest >>= RADIX_BITS) size++;
+    int code = resize_body(t, size);
+    if (code != BN_OK) return code;
+    for (int i = 0; i < size; i++, magnitude >>= RADIX_BITS) {
+        t->body[i] = magnitude & (RADIX - 1);
+    }
+    t->sign = negative && !is_zero(t);
+    return BN_OK;
+}
+
+// t += (negative ? -magnitude : magnitude) for magnitude < 2^45.
+int add_word(bn *t, long long magnitude, int negative) {
+    int size = limb_count(t);
+    if (size == 1 && t->body[0] == 0) t->sign = negative;
+    if (t->sign == negative) {
+        long long carry = magnitude;
+        for (int i = 0; carry && i < t->bodysize; i++) {
+            long long sum = t->body[i] + carry;
+            t->body[i] = sum & (RADIX - 1);
+            carry = sum >> RADIX_BITS;
+        }
+        while (carry) {
+            int code = resize_body(t, t->bodysize + 1);
+            if (code != BN_OK) return code;
+            t->body[t->bodysize - 1] = carry & (RADIX - 1);
+            carry >>= RADIX_BITS;
+        }
+        return BN_OK;
+    }
+    if (size <= 3) {
+        long long value = 0;
+        for (int i = size; i > 0; i--) {
+            value = (value << RADIX_BITS) | t->body[i - 1];
+        }
+        if (value < magnitude) return set_word(t, magnitude - value, negative);
+    }
+    long long borrow = magnitude;
+    for (int i = 0; borrow && i < t->bodysize; i++) {
+        long long diff = t->body[i] - borrow;
+        t->body[i] = diff & (RADIX - 1);
+        borrow = -(diff >> RADIX_BITS);
+    }
+    return trim_body(t);
+}
+
+int bn_add_int(bn *t, int right) {
     if (t == NULL) return BN_NULL_OBJECT;
-    int *arr = malloc(sizeof(int) * 128);
-    if (arr == NULL) return BN_NO_MEMORY;
-    int size = 0;
-    while (degree > 1) {
-        arr[size++] = degree & 1;
-        degree = degree & 1 ? degree - 1 : degree >> 1;
+    return add_word(t, right < 0 ? -(long long)right : right, right < 0);
+}
+
+int bn_sub_int(bn *t, int right) {
+    if (t == NULL) return BN_NULL_OBJECT;
+    return add_word(t, right < 0 ? -(long long)right : right, right > 0);
+}
+
+int bn_mul_int(bn *t, int right) {
+    if (t == NULL) return BN_NULL_OBJECT;
+    long long mult = right < 0 ? -(long long)right : right;
+    if (mult == 0 || is_zero(t)) return set_word(t, 0, 0);
+    long long carry = 0;
+    for (int i = 0; i < t->bodysize; i++) {
+        long long product = t->body[i] * mult + carry;
+        t->body[i] = product & (RADIX - 1);
+        carry = product >> RADIX_BITS;
+    }
+    while (carry) {
+        int code = resize_body(t, t->bodysize + 1);
+        if (code != BN_OK) return code;
+        t->body[t->bodysize - 1] = carry & (RADIX - 1);
+        carry >>= RADIX_BITS;
+    }
+    t->sign ^= right < 0;
+    return trim_body(t);
+}
+
+int bn_div_int(bn *t, int right) {
+    if (t == NULL) return BN_NULL_OBJECT;
+    if (right == 0) return BN_DIVIDE_BY_ZERO;
+    long long div = right < 0 ? -(long long)right : right, rem = 0;
+    int negative = !is_zero(t) && (t->sign ^ (right < 0));
+    for (int i = t->bodysize; i > 0; i--) {
+        long long cur = (rem << RADIX_BITS) | t->body[i - 1];
+        t->body[i - 1] = cur / div;
+        rem = cur % div;
     }
-    bn *res = bn_init(t);
-    if (res == NULL) return BN_NO_MEMORY;
-    int code = BN_OK;
-    while (size > 0) {
-        if (arr[--size]) {
-            code = bn_mul_to(res, t);
-            if (code != BN_OK) {
-                bn_delete(res);
-                return code;
+    t->sign = 0;
+    int code = trim_body(t);
+    if (code == BN_OK && negative && rem) code = add_word(t, 1, 0);
+    if (code != BN_OK) return code;
+    t->sign = negative && !is_zero(t);
+    return BN_OK;
+}
+
+int bn_mod_int(bn *t, int right) {
+    if (t == NULL) return BN_NULL_OBJECT;
+    if (right == 0) return BN_DIVIDE_BY_ZERO;
+    long long div = right < 0 ? -(long long)right : right, rem = 0;
+    for (int i = t->bodysize; i > 0; i--) {
+        rem = ((rem << RADIX_BITS) | t->body[i - 1]) % div;
+    }
+    if (rem && !is_zero(t) && (t->sign ^ (right < 0))) rem = div - rem;
+    return set_word(t, rem, right < 0);
+}
+
+int bn_cmp_int(bn const *t, int right) {
+    if (t == NULL) return BN_NULL_OBJECT;
+    int size = limb_count(t);
+    if (size > 3) return t->sign ? -1 : 1;
+    long long value = 0;
+    for (int i = size; i > 0; i--) {
+        value = (value << RADIX_BITS) | t->body[i - 1];
+    }
+    if (t->sign) value = -value;
+    return value < right ? -1 : value > right ? 1 : 0;
+}
+
+int bn_mul_limbs(int *res, int const *a, int asize, int const *b, int bsize) {
+    for (int i = 0; i < asize + bsize; i++) {
+        res[i] = 0;
+    }
+    for (int i = 0; i < asize; i++) {
+        if (a[i] == 0) continue;
+        long long carry = 0;
+        for (int j = 0; j < bsize; j++) {
+            long long cur = res[i + j] + (long long)a[i] * b[j] + carry;
+            res[i + j] = cur & (RADIX - 1);
+            carry = cur >> RADIX_BITS;
+        }
+        res[i + bsize] = carry;
+    }
+    int size = asize + bsize;
+    while (size > 1 && res[size - 1] == 0) size--;
+    return size;
+}
+
+int bn_sqr_limbs(int *res, int const *a, int asize) {
+    for (int i = 0; i < asize << 1; i++) {
+        res[i] = 0;
+    }
+    for (int i = 0; i < asize; i++) {
+        long long carry = 0;
+        for (int j = i + 1; j < asize; j++) {
+            long long cur = res[i + j] + (long long)a[i] * a[j] + carry;
+            res[i + j] = cur & (RADIX - 1);
+            carry = cur >> RADIX_BITS;
+        }
+        res[i + asize] = carry;
+    }
+    long long carry = 0;
+    for (int i = 0; i < asize; i++) {
+        long long square = (long long)a[i] * a[i];
+        long long lo = ((long long)res[2 * i] << 1) + (square & (RADIX - 1)) + carry;
+        res[2 * i] = lo & (RADIX - 1);
+        carry = lo >> RADIX_BITS;
+        long long hi = ((long long)res[2 * i + 1] << 1) + (square >> RADIX_BITS) + carry;
+        res[2 * i + 1] = hi & (RADIX - 1);
+        carry = hi >> RADIX_BITS;
+    }
+    int size = asize << 1;
+    while (size > 1 && res[size - 1] == 0) size--;
+    return size;
+}
+
+int pow_bit(int const *degree, long long bit) {
+    return (degree[bit / RADIX_BITS] >> (bit % RADIX_BITS)) & 1;
+}
+
+int pow_window(long long bits) {
+    if (bits <= 8) return 1;
+    if (bits <= 24) return 2;
+    if (bits <= 80) return 3;
+    if (bits <= 240) return 4;
+    if (bits <= 672) return 5;
+    return 6;
+}
+
+int reserve_limbs(int **buf, int *cap, long long size) {
+    if (size <= *cap) return BN_OK;
+    if (size > (1LL << 31) - 1) return BN_NO_MEMORY;
+    int *newbuf = bn_realloc(*buf, sizeof(int) * size);
+    if (newbuf == NULL) return BN_NO_MEMORY;
+    *buf = newbuf;
+    *cap = size;
+    return BN_OK;
+}
+
+void free_pow_table(int **table, int count) {
+    for (int i = 0; i < count; i++) {
+        bn_free(table[i]);
+    }
+}
+
+// |t| == 2^k: the power is a single set bit, no multiplications needed
+int pow_two_power(bn *t, int const *degree, int degreesize, int sign) {
+    int top = t->body[t->bodysize - 1];
+    long long k = (long long)RADIX_BITS * (t->bodysize - 1);
+    while (top > 1) {
+        top >>= 1;
+        k++;
+    }
+    long long e = 0;
+    if (k > 0) {
+        if (degreesize > 3) return BN_NO_MEMORY;
+        for (int i = degreesize; i > 0; i--) {
+            e = (e << RADIX_BITS) | degree[i - 1];
+        }
+        if (e > ((1LL << 31) - 2) * RADIX_BITS / k) return BN_NO_MEMORY;
+    }
+    long long bit = k * e;
+    int size = bit / RADIX_BITS + 1;
+    int *body = bn_malloc(sizeof(int) * size);
+    if (body == NULL) return BN_NO_MEMORY;
+    for (int i = 0; i < size - 1; i++) {
+        body[i] = 0;
+    }
+    body[size - 1] = 1 << (bit % RADIX_BITS);
+    bn_free(t->body);
+    t->body = body;
+    t->bodysize = size;
+    t->sign = sign;
+    return BN_OK;
+}
+
+// Left-to-right sliding window over the exponent given as RADIX limbs.
+// Odd powers t^1, t^3, ..., t^(2^k - 1) are precomputed, runs of zero
+// bits cost one squaring each and every window costs one multiplication.
+int bn_pow_limbs(bn *t, int const *degree, int degreesize) {
+    if (t == NULL || degree == NULL) return BN_NULL_OBJECT;
+    while (degreesize > 1 && degree[degreesize - 1] == 0) degreesize--;
+    if (degreesize == 1 && degree[0] == 0) {
+        return match_size(t, 1) != BN_OK ? BN_NO_MEMORY : bn_init_int(t, 1);
+    }
+    // The base may carry high zero limbs from bn_mul_to.
+    int code = trim_body(t);
+    if (code != BN_OK) return code;
+    if (is_zero(t)) return BN_OK;
+    int sign = t->sign & degree[0] & 1;
+    int top = t->body[t->bodysize - 1];
+    int single_bit = (top & (top - 1)) == 0;
+    for (int i = 0; i + 1 < t->bodysize && single_bit; i++) {
+        if (t->body[i] != 0) single_bit = 0;
+    }
+    if (single_bit) return pow_two_power(t, degree, degreesize, sign);
+
+    long long bits = (long long)RADIX_BITS * (degreesize - 1);
+    for (int top_degree = degree[degreesize - 1]; top_degree > 0; top_degree >>= 1) {
+        bits++;
+    }
+    int window = pow_window(bits);
+    int count = 1 << (window - 1);
+    int *table[32];
+    int tablesize[32];
+    int filled = 0;
+    int *acc = NULL, *tmp = NULL;
+    int acc_cap = 0, tmp_cap = 0;
+    code = reserve_limbs(&acc, &acc_cap, (long long)t->bodysize << 1);
+    if (code != BN_OK) return code;
+    table[0] = bn_malloc(sizeof(int) * t->bodysize);
+    if (table[0] == NULL) {
+        bn_free(acc);
+        return BN_NO_MEMORY;
+    }
+    for (int i = 0; i < t->bodysize; i++) {
+        table[0][i] = t->body[i];
+    }
+    tablesize[0] = t->bodysize;
+    filled = 1;
+    if (count > 1) {
+        int squaresize = bn_sqr_limbs(acc, t->body, t->bodysize);
+        for (; filled < count; filled++) {
+            int size = tablesize[filled - 1] + squaresize;
+            table[filled] = bn_malloc(sizeof(int) * size);
+            if (table[filled] == NULL) {
+                free_pow_table(table, filled);
+                bn_free(acc);
+                return BN_NO_MEMORY;
             }
+            tablesize[filled] = bn_mul_limbs(table[filled], table[filled - 1], tablesize[filled - 1], acc, squaresize);
+        }
+    }
+    int accsize = 0;
+    for (long long i = bits - 1; i >= 0;) {
+        if (pow_bit(degree, i) == 0) {
+            code = reserve_limbs(&tmp, &tmp_cap, (long long)accsize << 1);
+            if (code != BN_OK) break;
+            int newsize = bn_sqr_limbs(tmp, acc, accsize);
+            int *swap = acc; acc = tmp; tmp = swap;
+            int swap_cap = acc_cap; acc_cap = tmp_cap; tmp_cap = swap_cap;
+            accsize = newsize;
+            i--;
+            continue;
         }
-        else {
-            code = bn_mul_to(res, res);
-            if (code != BN_OK) {
-                bn_delete(res);
-                return code;
+        long long low = i - window + 1 < 0 ? 0 : i - window + 1;
+        while (pow_bit(degree, low) == 0) low++;
+        int value = 0;
+        for (long long j = i; j >= low; j--) {
+            value = (value << 1) | pow_bit(degree, j);
+        }
+        int *odd = table[value >> 1];
+        int oddsize = tablesize[value >> 1];
+        if (accsize == 0) {
+            code = reserve_limbs(&acc, &acc_cap, oddsize);
+            if (code != BN_OK) break;
+            for (int j = 0; j < oddsize; j++) {
+                acc[j] = odd[j];
             }
+            accsize = oddsize;
+            i = low - 1;
+            continue;
         }
-    }
-    code = bn_copy_to(t, res);
+        for (long long j = i; j >= low; j--) {
+            code = reserve_limbs(&tmp, &tmp_cap, (long long)accsize << 1);
+            if (code != BN_OK) break;
+            int newsize = bn_sqr_limbs(tmp, acc, accsize);
+            int *swap = acc; acc = tmp; tmp = swap;
+            int swap_cap = acc_cap; acc_cap = tmp_cap; tmp_cap = swap_cap;
+            accsize = newsize;
+        }
+        if (code != BN_OK) break;
+        code = reserve_limbs(&tmp, &tmp_cap, (long long)accsize + oddsize);
+        if (code != BN_OK) break;
+        int newsize = bn_mul_limbs(tmp, acc, accsize, odd, oddsize);
+        int *swap = acc; acc = tmp; tmp = swap;
+        int swap_cap = acc_cap; acc_cap = tmp_cap; tmp_cap = swap_cap;
+        accsize = newsize;
+        i = low - 1;
+    }
+    free_pow_table(table, filled);
+    bn_free(tmp);
     if (code != BN_OK) {
-        bn_delete(t);
-        bn_delete(res);
+        bn_free(acc);
         return code;
     }
-    bn_delete(res);
-    free(arr);
+    bn_free(t->body);
+    t->body = acc;
+    t->bodysize = accsize;
+    t->sign = sign;
     return BN_OK;
 }
 
+// BN_BAD_ARGUMENT for a negative degree; t is left unchanged.
+int bn_pow_to(bn *t, int degree) {
+    if (t == NULL) return BN_NULL_OBJECT;
+    if (degree < 0) return BN_BAD_ARGUMENT;
+    int limbs[3];
+    int size = 0;
+    do {
+        limbs[size++] = degree & (RADIX - 1);
+        degree >>= RADIX_BITS;
+    } while (degree > 0);
+    return bn_pow_limbs(t, limbs, size);
+}
+
+int bn_pow_to_ull(bn *t, unsigned long long degree) {
+    if (t == NULL) return BN_NULL_OBJECT;
+    int limbs[5];
+    int size = 0;
+    do {
+        limbs[size++] = degree & (RADIX - 1);
+        degree >>= RADIX_BITS;
+    } while (degree > 0);
+    return bn_pow_limbs(t, limbs, size);
+}
+
+// BN_BAD_ARGUMENT for a negative degree; t is left unchanged.
+int bn_pow_to_bn(bn *t, bn const *degree) {
+    if (t == NULL || degree == NULL) return BN_NULL_OBJECT;
+    if (degree->sign && !is_zero(degree)) return BN_BAD_ARGUMENT;
+    if (t != degree) return bn_pow_limbs(t, degree->body, degree->bodysize);
+    bn *degree_copy = bn_init(degree);
+    if (degree_copy == NULL) return BN_NO_MEMORY;
+    int code = bn_pow_limbs(t, degree_copy->body, degree_copy->bodysize);
+    bn_delete(degree_copy);
+    return code;
+}
+
 //Heron
 int bn_root_to(bn *t, int reciprocal) {
     if (t == NULL) return BN_NULL_OBJECT;
@@ -1415,65 +1883,278 @@ int bn_root_to_binary_search(bn *t, int reciprocal) {
 
 const char *bn_to_string(bn const *t, int radix_to) {
     if (t == NULL) return NULL;
-    if (is_zero(t)) {
-        char *out = malloc(2);
-        if (out == NULL) return NULL;
-        out[0] = DIGITS[0];
-        out[1] = '\0';
-        return (const char*)out;
-    }
-    bn *bn_copy = bn_init(t);
-    if (bn_copy == NULL) return NULL;
-    int int_rem = 0, *ptr_rem = &int_rem;
-    char *out = malloc(1);
-    if (out == NULL) {
-        bn_delete(bn_copy);
-        return NULL;
-    }
-    size_t out_cap = 1, *ptr_out_cap = &out_cap;
+    int bits = floor_log2(radix_to);
+    int size = limb_count(t);
+    size_t total_bits = (size_t)RADIX_BITS * (size - 1);
+    for (int top = t->body[size - 1]; top > 0; top >>= 1) {
+        total_bits++;
+    }
+    char *out = malloc(total_bits / bits + 3);
+    if (out == NULL) return NULL;
     size_t index = 0;
-    while (bn_copy->body[0] > 0 || bn_copy->bodysize > 1) {
-        int code = bn_div_short(bn_copy, radix_to, ptr_rem);
-        if (code != BN_OK) {
-            bn_delete(bn_copy);
+    if ((1 << bits) == radix_to) {
+        for (size_t bit = 0; bit < total_bits; bit += bits) {
+            size_t limb = bit / RADIX_BITS;
+            int offset = bit % RADIX_BITS;
+            long long window = t->body[limb] >> offset;
+            if (limb + 1 < (size_t)size) {
+                window |= (long long)t->body[limb + 1] << (RADIX_BITS - offset);
+            }
+            out[index++] = DIGITS[window & (radix_to - 1)];
+        }
+    }
+    else {
+        int *work = bn_malloc(sizeof(int) * size);
+        if (work == NULL) {
             free(out);
             return NULL;
         }
-        if (out_cap <= index) {
-            out = expand_string(out, ptr_out_cap);
-            if (out == NULL) {
-                bn_delete(bn_copy);
-                return NULL;
+        for (int i = 0; i < size; i++) {
+            work[i] = t->body[i];
+        }
+        int chunk_pow;
+        int chunk = chunk_digits(radix_to, &chunk_pow);
+        while (size > 1 || work[0] > 0) {
+            long long rem = 0;
+            for (int i = size; i > 0; i--) {
+                long long cur = (rem << RADIX_BITS) | work[i - 1];
+                work[i - 1] = cur / chunk_pow;
+                rem = cur % chunk_pow;
+            }
+            while (size > 1 && work[size - 1] == 0) size--;
+            int last = size == 1 && work[0] == 0;
+            for (int j = 0; j < chunk && (!last || rem > 0); j++) {
+                out[index++] = DIGITS[rem % radix_to];
+                rem /= radix_to;
             }
         }
-        out[index] = DIGITS[int_rem];
-        index++;
+        bn_free(work);
     }
-    if (bn_copy->sign) {
-        out = realloc(out, index+1);
-        if (out == NULL) {
-            bn_delete(bn_copy);
-            return NULL;
+    if (index == 0) out[index++] = DIGITS[0];
+    else if (t->sign) out[index++] = '-';
+    for (size_t i = 0; i < index / 2; i++) {
+        char c = out[i];
+        out[i] = out[index - i - 1];
+        out[index - i - 1] = c;
+    }
+    out[index] = '\0';
+    return (const char*)out;
+}
+
+// Same binary layout as BigInteger::serialize in biginteger.h: tag byte,
+// limb count (varint, or three zero bytes and a u32 LE), u16 LE limbs.
+size_t bn_serialized_size(bn const *t, int varint) {
+    if (t == NULL) return 0;
+    size_t size = limb_count(t);
+    size_t header = SERIAL_HEADER;
+    if (varint) {
+        header = 2;
+        for (size_t count = size; count >= 0x80; count >>= 7) {
+            header++;
+        }
+    }
+    return header + 2 * size;
+}
+
+// BN_NO_MEMORY if buf is shorter than bn_serialized_size
+int bn_serialize(bn const *t, unsigned char *buf, size_t cap, size_t *written, int varint) {
+    if (t == NULL || buf == NULL) return BN_NULL_OBJECT;
+    size_t need = bn_serialized_size(t, varint);
+    if (cap < need) return BN_NO_MEMORY;
+    size_t pos = 0;
+    int size = limb_count(t);
+    size_t count = size;
+    int negative = t->sign && !(size == 1 && t->body[0] == 0);
+    buf[pos++] = (SERIAL_VERSION << 4) | (varint ? SERIAL_VARINT : 0) | (negative ? SERIAL_SIGN : 0);
+    if (varint) {
+        for (; count >= 0x80; count >>= 7) {
+            buf[pos++] = (count & 0x7f) | 0x80;
+        }
+        buf[pos++] = count;
+    }
+    else {
+        buf[pos++] = 0;
+        buf[pos++] = 0;
+        buf[pos++] = 0;
+        for (int i = 0; i < 4; i++) {
+            buf[pos++] = (count >> (8 * i)) & 0xff;
         }
-        out[index] = '-';
-        out = reverse(out, index+1);
-        out = realloc(out, index+2);
-        if (out == NULL) {
-            bn_delete(bn_copy);
-            return NULL;
+    }
+    for (int i = 0; i < size; i++) {
+        buf[pos++] = t->body[i] & 0xff;
+        buf[pos++] = t->body[i] >> 8;
+    }
+    if (written != NULL) *written = pos;
+    return BN_OK;
+}
+
+size_t read_serial_header(unsigned char const *buf, size_t size, size_t *count) {
+    if (size == 0 || (buf[0] >> 4) != SERIAL_VERSION || (buf[0] & 0x0c)) return 0;
+    *count = 0;
+    if (buf[0] & SERIAL_VARINT) {
+        for (size_t i = 1; i < size && i <= 9; i++) {
+            *count |= (size_t)(buf[i] & 0x7f) << (7 * (i - 1));
+            // A zero final byte after continuation bytes is an overlong encoding.
+            if (!(buf[i] & 0x80)) return *count == 0 || (i > 1 && buf[i] == 0) ? 0 : i + 1;
         }
-        out[index+1] = '\0';
+        return 0;
     }
-    else {
-        out = reverse(out, index);
-        out = realloc(out, index+1);
-        if (out == NULL) {
-            bn_delete(bn_copy);
-            return NULL;
+    if (size < SERIAL_HEADER || buf[1] || buf[2] || buf[3]) return 0;
+    for (int i = 0; i < 4; i++) {
+        *count |= (size_t)buf[4 + i] << (8 * i);
+    }
+    return *count == 0 ? 0 : SERIAL_HEADER;
+}
+
+// BN_BAD_FORMAT for truncated, unknown-version or non-canonical records;
+// t is left untouched on any error.
+int bn_deserialize(bn *t, unsigned char const *buf, size_t size, size_t *consumed) {
+    if (t == NULL || buf == NULL) return BN_NULL_OBJECT;
+    size_t count = 0;
+    size_t pos = read_serial_header(buf, size, &count);
+    if (pos == 0 || count > (size - pos) / 2 || count > (1U << 31) - 1) return BN_BAD_FORMAT;
+    int sign = buf[0] & SERIAL_SIGN;
+    int top = buf[pos + 2 * count - 2] | (buf[pos + 2 * count - 1] << 8);
+    if (count > 1 && top == 0) return BN_BAD_FORMAT;
+    if (count == 1 && top == 0 && sign) return BN_BAD_FORMAT;
+    int *body = bn_malloc(sizeof(int) * count);
+    if (body == NULL) return BN_NO_MEMORY;
+    for (size_t i = 0; i < count; i++) {
+        body[i] = buf[pos + 2 * i] | (buf[pos + 2 * i + 1] << 8);
+        if (body[i] >= RADIX) {
+            bn_free(body);
+            return BN_BAD_FORMAT;
+        }
+    }
+    bn_free(t->body);
+    t->body = body;
+    t->bodysize = count;
+    t->sign = sign;
+    if (consumed != NULL) *consumed = pos + 2 * count;
+    return BN_OK;
+}
+
+int bn_serialize_array(bn *const *arr, size_t count, unsigned char *buf, size_t cap, size_t *written, int varint) {
+    if (arr == NULL || buf == NULL) return BN_NULL_OBJECT;
+    if (cap < SERIAL_ARRAY_HEADER) return BN_NO_MEMORY;
+    unsigned char header[8] = {'B', 'I', 'G', 'N', SERIAL_VERSION, SERIAL_KIND, 0, 0};
+    for (int i = 0; i < 8; i++) {
+        buf[i] = header[i];
+        buf[8 + i] = ((unsigned long long)count >> (8 * i)) & 0xff;
+    }
+    size_t pos = SERIAL_ARRAY_HEADER;
+    for (size_t i = 0; i < count; i++) {
+        size_t len = 0;
+        int code = bn_serialize(arr[i], buf + pos, cap - pos, &len, varint);
+        if (code != BN_OK) return code;
+        pos += len;
+    }
+    if (written != NULL) *written = pos;
+    return BN_OK;
+}
+
+// Allocates *arr with *count new numbers; the caller owns both.
+int bn_deserialize_array(bn ***arr, size_t *count, unsigned char const *buf, size_t size, size_t *consumed) {
+    if (arr == NULL || count == NULL || buf == NULL) return BN_NULL_OBJECT;
+    if (size < SERIAL_ARRAY_HEADER || buf[0] != 'B' || buf[1] != 'I' || buf[2] != 'G' || buf[3] != 'N') return BN_BAD_FORMAT;
+    if (buf[4] != SERIAL_VERSION || buf[5] != SERIAL_KIND || buf[6] || buf[7]) return BN_BAD_FORMAT;
+    unsigned long long n = 0;
+    for (int i = 0; i < 8; i++) {
+        n |= (unsigned long long)buf[8 + i] << (8 * i);
+    }
+    if (n > (size - SERIAL_ARRAY_HEADER) / SERIAL_MIN_RECORD) return BN_BAD_FORMAT;
+    bn **res = malloc(sizeof(bn*) * (n == 0 ? 1 : n));
+    if (res == NULL) return BN_NO_MEMORY;
+    size_t pos = SERIAL_ARRAY_HEADER;
+    for (size_t i = 0; i < n; i++) {
+        size_t len = 0;
+        int code = BN_NO_MEMORY;
+        res[i] = bn_new();
+        if (res[i] != NULL) code = bn_deserialize(res[i], buf + pos, size - pos, &len);
+        if (code != BN_OK) {
+            for (size_t j = 0; j <= i; j++) {
+                bn_delete(res[j]);
+            }
+            free(res);
+            return code;
         }
-        out[index] = '\0';
+        pos += len;
     }
-    bn_delete(bn_copy); 
-    const char* ret = (const char*) out;
-    return ret;
+    *arr = res;
+    *count = n;
+    if (consumed != NULL) *consumed = pos;
+    return BN_OK;
+}
+
+int host_endian() {
+    unsigned short probe = 1;
+    return *(unsigned char*)&probe ? -1 : 1;
+}
+
+// mpz_import conventions: order and endian are 1 for most significant
+// first, -1 for least significant first, endian 0 is the host order.
+// Only the magnitude is imported; t becomes non-negative.
+int bn_import(bn *t, size_t count, int order, size_t size, int endian, const void *op) {
+    if (t == NULL || (op == NULL && count > 0)) return BN_NULL_OBJECT;
+    unsigned char const *data = op;
+    if (endian == 0) endian = host_endian();
+    size_t total = count * size;
+    int *body = bn_malloc(sizeof(int) * (total * 8 / RADIX_BITS + 1));
+    if (body == NULL) return BN_NO_MEMORY;
+    int bodysize = 0;
+    unsigned int acc = 0;
+    int accbits = 0;
+    for (size_t k = 0; k < total; k++) {
+        size_t word = order < 0 ? k / size : count - 1 - k / size;
+        size_t byte = endian < 0 ? k % size : size - 1 - k % size;
+        acc |= (unsigned int)data[word * size + byte] << accbits;
+        accbits += 8;
+        if (accbits >= RADIX_BITS) {
+            body[bodysize++] = acc & (RADIX - 1);
+            acc >>= RADIX_BITS;
+            accbits -= RADIX_BITS;
+        }
+    }
+    body[bodysize++] = acc;
+    while (bodysize > 1 && body[bodysize - 1] == 0) bodysize--;
+    bn_free(t->body);
+    t->body = body;
+    t->bodysize = bodysize;
+    t->sign = 0;
+    return BN_OK;
+}
+
+// mpz_export conventions: writes |t| into rop, or into a malloc'ed buffer
+// when rop is NULL, and stores the number of words in *countp (0 for zero).
+// Returns NULL with *countp = 0 for a word size of 0.
+void *bn_export(void *rop, size_t *countp, int order, size_t size, int endian, bn const *t) {
+    if (countp != NULL) *countp = 0;
+    if (t == NULL || size == 0) return NULL;
+    if (endian == 0) endian = host_endian();
+    int limbs = limb_count(t);
+    size_t bits = (size_t)RADIX_BITS * (limbs - 1);
+    for (int top = t->body[limbs - 1]; top > 0; top >>= 1) {
+        bits++;
+    }
+    size_t bytes = (bits + 7) / 8;
+    size_t count = (bytes + size - 1) / size;
+    unsigned char *out = rop;
+    if (out == NULL) {
+        out = malloc(count == 0 ? 1 : count * size);
+        if (out == NULL) return NULL;
+    }
+    for (size_t k = 0; k < count * size; k++) {
+        out[k] = 0;
+    }
+    for (size_t k = 0; k < bytes; k++) {
+        size_t limb = k * 8 / RADIX_BITS;
+        int offset = k * 8 % RADIX_BITS;
+        unsigned int window = t->body[limb] >> offset;
+        if (limb + 1 < (size_t)limbs) window |= (unsigned int)t->body[limb + 1] << (RADIX_BITS - offset);
+        size_t word = order < 0 ? k / size : count - 1 - k / size;
+        size_t byte = endian < 0 ? k % size : size - 1 - k % size;
+        out[word * size + byte] = window & 0xff;
+    }
+    if (countp != NULL) *countp = count;
+    return out;
 }
@@ -0,0 +1,1252 @@
+/*
+ * Regression tests for biginteger.h and bn.c, built and run by
+ * `make test`. bn.h is not part of this tree, so by hand the bn typedef is
+ * supplied on the command line:
+ *
+ *   cc -O2 '-Dbn=struct bn_s' -c bn.c -o bn.o
+ *   c++ -O2 -std=c++17 -Wall tests/test.cpp bn.o -o test_bigint -lpthread
+ *   ./test_bigint
+ *
+ * FixedBigInteger and _bi literals are tested from C++14, their constant
+ * evaluation from C++17; the rest builds as C++11. The counters are tested
+ * when built with -DBIGINT_STATS, -DBIGINT_MEMORY_STATS and, against a bn.o
+ * built the same way, -DBN_MEMORY_STATS.
+ *
+ * Prints every failed check and exits nonzero if there was one. The
+ * randomized sections use fixed seeds, so failures are reproducible.
+ */
+
+#define BIGINT_MMAP
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+#include "../biginteger.h"
+
+extern "C" {
+typedef struct bn_s bn;
+bn *bn_new();
+int bn_delete(bn *t);
+int bn_init_int(bn *t, int init_int);
+int bn_mul_to(bn *t, bn const *right);
+const char *bn_to_string(bn const *t, int radix);
+int bn_init_string(bn *t, const char *init_string);
+int bn_add_int(bn *t, int right);
+int bn_sub_int(bn *t, int right);
+int bn_mul_int(bn *t, int right);
+int bn_cmp_int(bn const *t, int right);
+int bn_deserialize(bn *t, unsigned char const *buf, size_t size, size_t *consumed);
+int bn_pow_to(bn *t, int degree);
+int bn_pow_to_bn(bn *t, bn const *degree);
+int bn_pow_to_ull(bn *t, unsigned long long degree);
+int bn_init_string_radix(bn *t, const char *init_string, int radix);
+size_t bn_serialized_size(bn const *t, int varint);
+int bn_serialize(bn const *t, unsigned char *buf, size_t cap, size_t *written, int varint);
+int bn_import(bn *t, size_t count, int order, size_t size, int endian, const void *op);
+void *bn_export(void *rop, size_t *countp, int order, size_t size, int endian, bn const *t);
+#ifdef BN_MEMORY_STATS
+struct bn_memory_stats {
+    size_t live_blocks;
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t histogram[48];
+};
+int bn_memory_stats(struct bn_memory_stats *out);
+int bn_memory_reset_peak();
+#endif
+}
+
+// Same values as enum bn_codes in bn.c.
+enum { BN_OK, BN_NULL_OBJECT, BN_NO_MEMORY, BN_DIVIDE_BY_ZERO, BN_BAD_FORMAT, BN_BAD_ARGUMENT };
+
+static int failures = 0;
+
+// Counts heap allocations from the test itself and from biginteger.h.
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+// Kept out of line: inlined into a delete expression, free() after the
+// replaced operator new trips -Wmismatched-new-delete.
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void *p, size_t) noexcept {
+    operator delete(p);
+}
+#endif
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static void test_stream_format() {
+    std::ostringstream os;
+    os << std::setw(8) << std::setfill('*') << BigInteger(42) << "|";
+    CHECK(os.str() == "******42|");
+    os.str("");
+    os << std::left << std::setw(6) << std::setfill('.') << BigInteger(-7) << "|";
+    CHECK(os.str() == "-7....|");
+    os.str("");
+    os << std::setw(6) << Rational(BigInteger(1), BigInteger(3)) << "|";
+    CHECK(os.str() == "1/3...|");
+}
+
+static std::string bn_string(bn const *t, int radix) {
+    const char *s = bn_to_string(t, radix);
+    std::string ret = s;
+    free((void*)s);
+    return ret;
+}
+
+// 0 * 32769 leaves bodysize == 2 with both limbs zero.
+static void test_bn_radix_leading_zero_limbs() {
+    bn *z = bn_new(), *m = bn_new();
+    bn_init_int(z, 0);
+    bn_init_int(m, 32769);
+    bn_mul_to(z, m);
+    CHECK(bn_string(z, 16) == "0");
+    CHECK(bn_string(z, 2) == "0");
+    CHECK(bn_string(z, 10) == "0");
+    bn_init_int(z, -255);
+    CHECK(bn_string(z, 16) == "-FF");
+    CHECK(bn_string(z, 2) == "-11111111");
+    bn_delete(z);
+    bn_delete(m);
+}
+
+// bn_mul_to leaves a zero times a multi-limb value with bodysize > 1.
+static bn *untrimmed_zero(const char *factor) {
+    bn *z = bn_new(), *m = bn_new();
+    bn_init_int(z, 0);
+    bn_init_string(m, factor);
+    bn_mul_to(z, m);
+    bn_delete(m);
+    return z;
+}
+
+static void test_bn_int_leading_zero_limbs() {
+    bn *z = untrimmed_zero("32769");
+    CHECK(bn_cmp_int(z, 0) == 0);
+    bn_delete(z);
+    z = untrimmed_zero("1000000000000000000000");
+    CHECK(bn_cmp_int(z, 5) == -1);
+    CHECK(bn_cmp_int(z, -5) == 1);
+    bn_sub_int(z, 5);
+    CHECK(bn_string(z, 10) == "-5");
+    bn_delete(z);
+    z = untrimmed_zero("1000000000000000000000");
+    bn_add_int(z, 7);
+    CHECK(bn_string(z, 16) == "7");
+    bn_delete(z);
+    z = bn_new();
+    bn_init_int(z, 7);
+    bn_mul_int(z, 0);
+    CHECK(bn_string(z, 16) == "0");
+    CHECK(bn_cmp_int(z, 0) == 0);
+    bn_delete(z);
+}
+
+static void test_lazy_expressions() {
+    static_assert(!std::is_constructible<BigInteger, std::vector<BigInteger> >::value, "containers must not convert to BigInteger");
+    static_assert(!std::is_constructible<Rational, std::vector<Rational> >::value, "containers must not convert to Rational");
+    static_assert(!std::is_convertible<LazyProduct<LazyTerm<BigInteger>, LazyTerm<BigInteger> >, BigInteger>::value, "expression constructor is explicit");
+    BigInteger a("123456789012345678901234567890"), b(-98765), c(5), r;
+    r = lazy(a) * b + lazy(c) * a - c;
+    CHECK(r == a * b + c * a - c);
+    r = -(lazy(a) + b) * c;
+    CHECK(r == -(a + b) * c);
+    r += lazy(r) * c;
+    CHECK(r == -(a + b) * c * 6);
+    BigInteger d(lazy(a) * a);
+    CHECK(d == a * a);
+    Rational x(BigInteger(3), BigInteger(7)), y(BigInteger(-5), BigInteger(11)), z(BigInteger(2), BigInteger(9)), q;
+    q = lazy(x) * y + lazy(z) * x - y;
+    CHECK(q == x * y + z * x - y);
+    q -= lazy(x) * (lazy(y) + z);
+    CHECK(q == x * y + z * x - y - x * (y + z));
+}
+
+static void test_remainder_aliasing() {
+    BigInteger big("123456789012345678901234567890");
+    BigInteger a(-12345);
+    a %= big;
+    CHECK(a == -12345);
+    BigInteger b(77);
+    BigIntegerWorkspace ws;
+    b.remainder(big, ws);
+    CHECK(b == 77);
+    BigInteger c("1000000000000000000000000000000000000");
+    c %= BigInteger("1000000000000000000001");
+    CHECK(c == BigInteger("999999000000000000001"));
+    BigInteger d = big;
+    d %= d;
+    CHECK(d == 0);
+}
+
+static void test_serialization() {
+    std::vector<unsigned char> buf;
+    BigInteger(2).serialize(buf, true);
+    BigInteger(4).serialize(buf, true);
+    Rational r(7);
+    CHECK(r.deserialize(buf.data(), buf.size()) == 0);
+    CHECK(r == 7);
+    buf.clear();
+    Rational half(BigInteger(1), BigInteger(2));
+    half.serialize(buf, true);
+    CHECK(r.deserialize(buf.data(), buf.size()) == buf.size());
+    CHECK(r == half);
+
+    // Limb count 1 written as 0x81 0x00 instead of 0x01.
+    const unsigned char overlong[] = {0x12, 0x81, 0x00, 0x05, 0x00};
+    const unsigned char canonical[] = {0x12, 0x01, 0x05, 0x00};
+    BigInteger x(9);
+    CHECK(x.deserialize(overlong, sizeof(overlong)) == 0);
+    CHECK(x == 9);
+    CHECK(x.deserialize(canonical, sizeof(canonical)) == sizeof(canonical));
+    CHECK(x == 5);
+
+    bn *t = bn_new();
+    size_t consumed = 0;
+    CHECK(bn_deserialize(t, overlong, sizeof(overlong), &consumed) == BN_BAD_FORMAT);
+    CHECK(bn_deserialize(t, canonical, sizeof(canonical), &consumed) == BN_OK);
+    CHECK(bn_string(t, 10) == "5");
+    bn_delete(t);
+}
+
+static void test_bn_pow_negative() {
+    bn *t = bn_new(), *d = bn_new();
+    bn_init_int(t, 3);
+    CHECK(bn_pow_to(t, -1) == BN_BAD_ARGUMENT);
+    CHECK(bn_string(t, 10) == "3");
+    bn_init_int(d, -2);
+    CHECK(bn_pow_to_bn(t, d) == BN_BAD_ARGUMENT);
+    CHECK(bn_pow_to(t, 5) == BN_OK);
+    CHECK(bn_string(t, 10) == "243");
+    bn_delete(t);
+    bn_delete(d);
+}
+
+static void test_views() {
+    std::vector<unsigned char> buf;
+    BigInteger a("-123456789012345678901234567890"), b(77);
+    size_t first = a.serialize(buf);
+    b.serialize(buf, true);
+    BigIntegerView va, vb;
+    CHECK(va.view(buf.data(), buf.size()) == first);
+    CHECK(vb.view(buf.data() + first, buf.size() - first) == buf.size() - first);
+    CHECK(BigInteger(va) == a);
+    CHECK(va < vb && vb > a && !(vb == a));
+    BigInteger c(10);
+    c += vb;
+    c -= va;
+    CHECK(c == BigInteger(87) - a);
+    std::ostringstream os;
+    os << va;
+    CHECK(os.str() == a.toString());
+    CHECK(va.view(buf.data(), first - 1) == 0);
+}
+
+static void test_mapped() {
+    char path[] = "/tmp/test_bigintXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+    std::vector<BigInteger> values;
+    values.push_back(BigInteger("98765432109876543210"));
+    values.push_back(BigInteger(-3));
+    values.push_back(BigInteger(0));
+    std::vector<unsigned char> buf;
+    serialize(values, buf, true);
+    CHECK(write(fd, buf.data(), buf.size()) == (ssize_t)buf.size());
+    ::close(fd);
+    MappedBigIntegers mapped;
+    CHECK(mapped.open(path) == 0);
+    CHECK(mapped.size() == 3);
+    for (size_t i = 0; i < mapped.size() && i < values.size(); i++) {
+        CHECK(BigInteger(mapped[i]) == values[i]);
+    }
+    unlink(path);
+}
+
+static void test_mapped_count() {
+    char path[] = "/tmp/test_bigintXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+    unsigned char data[SERIAL_ARRAY_HEADER + 8] = {'B', 'I', 'G', 'N', SERIAL_VERSION, BigInteger::SERIAL_KIND};
+    data[8] = 0xff;
+    data[11] = 0x7f;
+    CHECK(write(fd, data, sizeof(data)) == (ssize_t)sizeof(data));
+    ::close(fd);
+    MappedBigIntegers mapped;
+    CHECK(mapped.open(path) == -1);
+    unlink(path);
+}
+
+static void test_pow() {
+    BigInteger a(3);
+    a.pow(40ULL);
+    CHECK(a == BigInteger("12157665459056928801"));
+    a = -2;
+    a.pow(65ULL);
+    CHECK(a.toString() == "-36893488147419103232");
+    a = 7;
+    a.pow(0ULL);
+    CHECK(a == 1);
+    a = 0;
+    a.pow(5ULL);
+    CHECK(a == 0);
+    a = 10;
+    a.pow(BigInteger(50));
+    CHECK(a.toString() == "1" + std::string(50, '0'));
+    a = 5;
+    a.pow(BigInteger(-2));
+    CHECK(a == 0);
+    a = -1;
+    a.pow(BigInteger(-3));
+    CHECK(a == -1);
+    a = -1;
+    a.pow(BigInteger(-4));
+    CHECK(a == 1);
+
+    bn *t = bn_new(), *d = bn_new();
+    bn_init_int(t, -3);
+    CHECK(bn_pow_to_ull(t, 41ULL) == BN_OK);
+    CHECK(bn_string(t, 10) == "-36472996377170786403");
+    bn_delete(t);
+    t = bn_new();
+    bn_init_int(t, 2);
+    CHECK(bn_pow_to_ull(t, 100ULL) == BN_OK);
+    CHECK(bn_string(t, 16) == "1" + std::string(25, '0'));
+    bn_init_string(d, "20");
+    CHECK(bn_pow_to_bn(t, d) == BN_OK);
+    CHECK(bn_string(t, 2) == "1" + std::string(2000, '0'));
+    bn_delete(t);
+    bn_delete(d);
+    t = untrimmed_zero("32769");
+    CHECK(bn_pow_to(t, 3) == BN_OK);
+    CHECK(bn_string(t, 10) == "0");
+    bn_delete(t);
+}
+
+// Power-of-two radices take the bit-packing path; radix 10 does not.
+static void test_bn_radix_round_trip() {
+    const char *dec = "-123456789012345678901234567890123456789";
+    bn *ref = bn_new();
+    bn_init_string(ref, dec);
+    const int radices[] = {2, 4, 8, 16, 32, 3, 36};
+    for (size_t i = 0; i < sizeof(radices) / sizeof(radices[0]); i++) {
+        std::string s = bn_string(ref, radices[i]);
+        bn *t = bn_new();
+        CHECK(bn_init_string_radix(t, s.c_str(), radices[i]) == BN_OK);
+        CHECK(bn_string(t, 10) == dec);
+        bn_delete(t);
+    }
+    CHECK(bn_string(ref, 16) == "-5CE0E9A56015FEC5AADFA328AE398115");
+    bn *t = bn_new();
+    CHECK(bn_init_string_radix(t, "0000ff", 16) == BN_OK);
+    CHECK(bn_string(t, 10) == "255");
+    bn_delete(t);
+    bn_delete(ref);
+}
+
+static void test_bn_serialize_leading_zero_limbs() {
+    bn *z = untrimmed_zero("32769");
+    unsigned char buf[16];
+    size_t written = 0, consumed = 0;
+    CHECK(bn_serialized_size(z, 0) == 10);
+    CHECK(bn_serialize(z, buf, sizeof(buf), &written, 0) == BN_OK);
+    CHECK(written == 10);
+    bn *back = bn_new();
+    CHECK(bn_deserialize(back, buf, written, &consumed) == BN_OK);
+    CHECK(consumed == written);
+    CHECK(bn_string(back, 10) == "0");
+    bn_delete(back);
+
+    // -1 * 0 keeps the sign bit set on an untrimmed zero.
+    bn_delete(z);
+    z = untrimmed_zero("-1000000000000000000000");
+    CHECK(bn_serialize(z, buf, sizeof(buf), &written, 1) == BN_OK);
+    CHECK(written == 4);
+    back = bn_new();
+    CHECK(bn_deserialize(back, buf, written, &consumed) == BN_OK);
+    CHECK(bn_string(back, 10) == "0");
+    bn_delete(back);
+
+    size_t count = 99;
+    void *words = bn_export(NULL, &count, 1, 4, 1, z);
+    CHECK(count == 0);
+    free(words);
+    CHECK(bn_export(NULL, &count, 1, 0, 1, z) == NULL);
+    bn_delete(z);
+}
+
+static void test_import_export() {
+    const unsigned char words[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+    BigInteger a;
+    a.import_bytes(3, 1, 3, 1, words);
+    CHECK(a == BigInteger("18591708106338011145"));
+    std::vector<unsigned char> out;
+    CHECK(a.export_bytes(out, 1, 3, 1) == 3);
+    CHECK(out == std::vector<unsigned char>(words, words + 9));
+    CHECK(a.export_bytes(out, -1, 2, -1) == 5);
+    CHECK(out[0] == 0x09 && out[1] == 0x08 && out[8] == 0x01 && out[9] == 0x00);
+    CHECK(a.export_bytes(out, 1, 0, 1) == 0);
+    CHECK(out.empty());
+
+    bn *t = bn_new();
+    CHECK(bn_import(t, 3, 1, 3, 1, words) == BN_OK);
+    CHECK(bn_string(t, 10) == "18591708106338011145");
+    size_t count = 0;
+    unsigned char *back = (unsigned char*)bn_export(NULL, &count, 1, 3, 1, t);
+    CHECK(count == 3 && memcmp(back, words, 9) == 0);
+    free(back);
+    bn_delete(t);
+}
+
+static void test_reader_writer() {
+    std::vector<BigInteger> values;
+    values.push_back(BigInteger("-1000000000000000000000000000001"));
+    values.push_back(BigInteger(0));
+    values.push_back(BigInteger("123456789123456789"));
+    std::ostringstream os;
+    {
+        BigIntegerWriter writer(os, 4);
+        for (size_t i = 0; i < values.size(); i++) {
+            writer.write(values[i]);
+            writer.put('\n');
+        }
+    }
+    CHECK(os.str() == "-1000000000000000000000000000001\n0\n123456789123456789\n");
+    std::istringstream is(os.str() + "  42 x");
+    BigIntegerReader reader(is, 3);
+    BigInteger x;
+    for (size_t i = 0; i < values.size(); i++) {
+        CHECK(reader.read(x) && x == values[i]);
+    }
+    CHECK(reader.read(x) && x == 42);
+    CHECK(!reader.read(x) && reader.fail());
+
+    os.str("");
+    os << values[0] << ' ' << values[1];
+    CHECK(os.str() == "-1000000000000000000000000000001 0");
+    is.clear();
+    is.str(" -00012 7");
+    CHECK(is >> x && x == -12);
+
+    std::vector<BigInteger> many;
+    for (int i = -2000; i < 20000; i += 7) many.push_back(BigInteger(i) * BigInteger("1000000000000000000000"));
+    os.str("");
+    write_lines(os, many.data(), many.size(), 4);
+    std::string text = os.str();
+    std::vector<BigInteger> back(1, BigInteger(5));
+    CHECK(read_lines(text.data(), text.size(), back, 4) == 0);
+    CHECK(back.size() == many.size() + 1 && back[0] == 5);
+    CHECK(std::equal(many.begin(), many.end(), back.begin() + 1));
+    back.clear();
+    CHECK(read_lines("1\n\n  -2 \n3", 10, back, 8) == 0);
+    CHECK(back.size() == 3 && back[1] == -2);
+    CHECK(read_lines("1\n2 3\n", 6, back, 0) == -1);
+    CHECK(back.size() == 3);
+}
+
+static BigInteger power_of_two(int n) {
+    BigInteger p = 1;
+    p <<= n;
+    return p;
+}
+
+static void test_rational_to_double() {
+    CHECK((double)Rational(BigInteger(1), BigInteger(3)) == 1.0 / 3);
+    CHECK((double)Rational(BigInteger(-22), BigInteger(7)) == -22.0 / 7);
+    BigInteger big("1" + std::string(400, '0'));
+    CHECK((double)Rational(big, big * 3 / 10) == 10.0 / 3);
+    CHECK((double)Rational(big * 7, big * 9) == 7.0 / 9);
+
+    // Halfway cases round to even, anything above goes up.
+    Rational one(1.0), next(std::nextafter(1.0, 2.0)), next2(std::nextafter(std::nextafter(1.0, 2.0), 2.0));
+    Rational mid = (one + next) * Rational(BigInteger(1), BigInteger(2));
+    CHECK((double)mid == 1.0);
+    CHECK((double)((next + next2) * Rational(BigInteger(1), BigInteger(2))) == (double)next2);
+    CHECK((double)(mid + Rational(BigInteger(1), power_of_two(200))) == (double)next);
+    CHECK((double)(-mid) == -1.0);
+
+    // Subnormals, underflow and overflow.
+    double tiny = std::numeric_limits<double>::denorm_min();
+    CHECK((double)Rational(BigInteger(1), power_of_two(1074)) == tiny);
+    CHECK((double)Rational(BigInteger(3), power_of_two(1076)) == tiny);
+    CHECK((double)Rational(BigInteger(1), power_of_two(1075)) == 0.0);
+    CHECK((double)Rational(BigInteger(3), power_of_two(1075)) == 2 * tiny);
+    CHECK((double)Rational(BigInteger(1), power_of_two(1022)) == std::numeric_limits<double>::min());
+    CHECK((double)Rational(power_of_two(1024)) == HUGE_VAL);
+    CHECK((double)Rational(-power_of_two(1100), BigInteger(3)) == -HUGE_VAL);
+    CHECK((double)Rational(power_of_two(1024) - power_of_two(970) - 1) == std::numeric_limits<double>::max());
+    CHECK((double)Rational(power_of_two(1024) - power_of_two(970)) == HUGE_VAL);
+
+    std::mt19937_64 rng(26);
+    for (int i = 0; i < 2000; i++) {
+        double d = std::ldexp((double)(rng() >> 11), (int)(rng() % 2000) - 1100);
+        if (rng() & 1) d = -d;
+        CHECK((double)Rational(d) == d);
+        long long p = (long long)(rng() >> 12) + 1, q = (long long)(rng() >> 12) + 1;
+        CHECK((double)Rational(BigInteger(p), BigInteger(q)) == (double)p / (double)q);
+    }
+}
+
+static void test_construct_exact() {
+    CHECK(BigInteger(INT_MIN).toString() == "-2147483648");
+    CHECK(BigInteger(UINT_MAX).toString() == "4294967295");
+    CHECK(BigInteger(LLONG_MIN).toString() == "-9223372036854775808");
+    CHECK(BigInteger(ULLONG_MAX).toString() == "18446744073709551615");
+    CHECK(BigInteger(-1L) == -1 && BigInteger(0UL).toString() == "0");
+    CHECK(Rational(LLONG_MIN) == Rational(BigInteger(LLONG_MIN)));
+
+    CHECK(BigInteger(-2.75) == -2);
+    CHECK(BigInteger(0.5) == 0 && BigInteger(-0.5).toString() == "0");
+    std::string e300 = BigInteger(1e300).toString();
+    CHECK(e300.size() == 301 && e300.compare(0, 24, "100000000000000005250476") == 0);
+    CHECK(e300.compare(289, 12, "459400540160") == 0);
+    CHECK(BigInteger(-9223372036854775808.0) == BigInteger(LLONG_MIN));
+    CHECK(BigInteger(18446744073709551616.0) == BigInteger(ULLONG_MAX) + 1);
+
+    CHECK(Rational(0.1) == Rational(BigInteger(3602879701896397LL), power_of_two(55)));
+    CHECK(Rational(-0.75) == Rational(BigInteger(-3), BigInteger(4)));
+    CHECK(Rational(3.0) == 3 && Rational(-0.0) == 0);
+    CHECK(Rational(std::numeric_limits<double>::denorm_min()) == Rational(BigInteger(1), power_of_two(1074)));
+    CHECK(Rational(1e300) == Rational(BigInteger(1e300)));
+    bool thrown = false;
+    try {
+        Rational r(std::numeric_limits<double>::quiet_NaN());
+    }
+    catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    thrown = false;
+    try {
+        BigInteger b(-HUGE_VAL);
+    }
+    catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+static void test_decimal_expansion() {
+    Rational third(BigInteger(1), BigInteger(3)), r(BigInteger(-22), BigInteger(7));
+    CHECK(third.asDecimal() == "0");
+    CHECK(third.asDecimal(5) == "0.33333");
+    CHECK(Rational(BigInteger(2), BigInteger(3)).asDecimal(3) == "0.667");
+    CHECK(r.asDecimal(4) == "-3.1429");
+    CHECK(Rational(BigInteger(-1), BigInteger(3)).asDecimal(0) == "0");
+    CHECK(Rational(BigInteger(19999), BigInteger(2000)).asDecimal(2) == "10.00");
+    CHECK(Rational(BigInteger(5), BigInteger(2)).asDecimal() == "3");
+    CHECK(Rational(0).asDecimal(3) == "0.000");
+    std::string long_third = third.asDecimal(100);
+    CHECK(long_third == "0." + std::string(100, '3'));
+
+    // Denominator above 2^31 takes the BigInteger path.
+    BigInteger d("100000000000000000000000000007");
+    Rational big(BigInteger(1), d);
+    DecimalExpansion e(big);
+    CHECK(!e.negative() && e.integer_part() == 0);
+    char digits[60];
+    e.digits(digits, sizeof(digits));
+    CHECK(std::string(digits, 29) == std::string(29, '0'));
+    CHECK(std::string(digits + 29, 31) == "9999999999999999999999999999300");
+
+    DecimalExpansion exact(Rational(BigInteger(-7), BigInteger(8)));
+    CHECK(exact.negative() && !exact.exact());
+    CHECK(exact.next() == 8 && exact.next() == 7 && exact.next() == 5);
+    CHECK(exact.exact());
+}
+
+static void test_inline_limbs() {
+    std::vector<BigInteger> values;
+    values.reserve(4);
+    const long long x = 3037000499LL, y = -1234567, z = 1LL << 40;
+    BigInteger a(x), b(y), c, q;
+    for (int round = 0; round < 2; round++) {
+        size_t before = allocations;
+        c = a;
+        c += b;
+        c -= BigInteger(z);
+        c *= b;
+        q = c / a;
+        c %= a;
+        BigInteger d(c), e(q);
+        std::swap(d, e);
+        values.clear();
+        values.push_back(e);
+        CHECK(c < a && values[0] == c && d == q);
+        if (round == 1) CHECK(allocations == before);
+    }
+    CHECK(q == (x + y - z) * y / x);
+    CHECK(c == (x + y - z) * y % x);
+
+    // Values that outgrow the inline limbs still round-trip through moves
+    // and swaps in both directions.
+    BigInteger big("123456789012345678901234567890123456789"), small(7);
+    std::swap(big, small);
+    CHECK(small == BigInteger("123456789012345678901234567890123456789") && big == 7);
+    BigInteger moved(std::move(small));
+    CHECK(moved.toString() == "123456789012345678901234567890123456789");
+    moved = std::move(big);
+    CHECK(moved == 7);
+    BigInteger shrink("1" + std::string(60, '0'));
+    shrink /= BigInteger("1" + std::string(55, '0'));
+    shrink.shrink_to_fit();
+    CHECK(shrink == 100000 && shrink.capacity() == BIGINT_INLINE_LIMBS);
+}
+
+#if __cplusplus >= 201402L
+static void test_fixed_width() {
+    typedef FixedBigInteger<128> Int128;
+    Int128 a = 1;
+    for (int i = 0; i < 127; i++) a += a;
+    CHECK(a.toString() == "-170141183460469231731687303715884105728");
+    CHECK(a < Int128(0) && a - 1 > Int128(0));
+    Int128 max = a - 1;
+    CHECK(max + 1 == a);
+    CHECK(Int128(-7) / Int128(2) == Int128(-3) && Int128(-7) % Int128(2) == Int128(-1));
+    CHECK(Int128(LLONG_MIN) * Int128(-1) == Int128(BigInteger(LLONG_MIN) * -1));
+
+    BigInteger big("123456789012345678901234567890123456789012345678901234567890");
+    FixedBigInteger<256> f(big), g(-big);
+    CHECK(BigInteger(f) == big && BigInteger(g) == -big);
+    CHECK(BigInteger(f * g) == BigInteger(FixedBigInteger<256>(big * -big)));
+    FixedBigInteger<64> low(big);
+    BigInteger modulus = 1;
+    modulus <<= 64;
+    BigInteger expect = big % modulus;
+    if (expect >= modulus / 2) expect -= modulus;
+    CHECK(BigInteger(low) == expect);
+
+    std::mt19937_64 rng(35);
+    for (int i = 0; i < 500; i++) {
+        long long x = (long long)rng(), y = (long long)(rng() >> (rng() % 63)) | 1;
+        FixedBigInteger<256> fx(x), fy(y);
+        BigInteger bx(x), by(y);
+        CHECK(BigInteger(fx * fy) == bx * by);
+        CHECK(BigInteger(fx / fy) == bx / by);
+        CHECK(BigInteger(fx % fy) == bx % by);
+        CHECK(BigInteger(fx - fy) == bx - by);
+        CHECK((fx < fy) == (bx < by));
+    }
+#if __cplusplus >= 201703L
+    constexpr Int128 c = Int128(1000000007) * Int128(998244353) % Int128(65537);
+    static_assert(c == Int128(998244353LL * 1000000007LL % 65537), "constexpr FixedBigInteger arithmetic");
+#endif
+}
+#endif
+
+#if __cplusplus >= 201402L
+static void test_literals() {
+    const BigInteger &a = 123456789012345678901234567890_bi;
+    CHECK(a == BigInteger("123456789012345678901234567890"));
+    CHECK(&a == &static_cast<const BigInteger&>(123456789012345678901234567890_bi));
+    CHECK(BigInteger(0_bi) == 0 && BigInteger(32768_bi) == 32768);
+    CHECK(1'000'000'000'000_bi == BigInteger(1000000000000LL));
+    CHECK(999999999999999999999999999999999999999999999_bi + 1 == BigInteger("1" + std::string(45, '0')));
+    static_assert(decltype(99999_bi)::CAPACITY >= 2, "two limbs for five nines");
+    static_assert(decltype(9999999999999999999999999999999999999999_bi)::CAPACITY * RADIX_BITS >= 133, "40 digits need 133 bits");
+    static_assert(decltype(9999999999999999999999999999999999999999_bi)::limbs.size == 9, "40 nines take 9 limbs");
+#if __cplusplus >= 201703L
+    constexpr FixedBigInteger<128> f = 170141183460469231731687303715884105727_bi;
+    static_assert(f + 1 < f, "2^127 - 1 wraps");
+#endif
+}
+#endif
+
+static BigInteger random_big(std::mt19937_64 &rng, size_t max_limbs) {
+    size_t limbs = rng() % max_limbs + 1;
+    BigInteger ret = 0;
+    for (size_t i = 0; i < limbs; i++) {
+        ret <<= 15;
+        ret += BigInteger((long long)(rng() & 0x7fff));
+    }
+    return rng() & 1 ? -ret : ret;
+}
+
+static void test_fused_multiply() {
+    std::mt19937_64 rng(38);
+    std::vector<BigInteger> a, b;
+    BigInteger expect = 0;
+    for (int i = 0; i < 300; i++) {
+        BigInteger x = random_big(rng, 90), y = random_big(rng, 90), acc = random_big(rng, 120);
+        BigInteger add = acc, sub = acc, shortmul = acc;
+        addmul(add, x, y);
+        submul(sub, x, y);
+        int m = (int)(rng() % 2000000001) - 1000000000;
+        addmul_short(shortmul, x, m);
+        CHECK(add == acc + x * y);
+        CHECK(sub == acc - x * y);
+        CHECK(shortmul == acc + x * BigInteger(m));
+        a.push_back(x);
+        b.push_back(y);
+        expect += x * y;
+    }
+    CHECK(dot(a, b) == expect);
+    CHECK(dot(a.data(), b.data(), 0) == 0);
+
+    // The accumulator may be one of the factors.
+    BigInteger x("-98765432109876543210987654321"), y("12345678901234567890");
+    BigInteger s = x;
+    addmul(s, s, y);
+    CHECK(s == x + x * y);
+    s = x;
+    submul(s, s, s);
+    CHECK(s == x - x * x);
+    s = y;
+    addmul_short(s, s, -3);
+    CHECK(s == y * -2);
+    bool thrown = false;
+    try {
+        dot(a, std::vector<BigInteger>(1));
+    }
+    catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+static void test_accumulator() {
+    std::mt19937_64 rng(39);
+    BigAccumulator acc;
+    CHECK(acc.value() == 0);
+    BigInteger expect = 0;
+    for (int i = 0; i < 20000; i++) {
+        BigInteger x = random_big(rng, i % 97 == 0 ? 40 : 3);
+        if (rng() & 1) {
+            acc += x;
+            expect += x;
+        }
+        else {
+            acc -= x;
+            expect -= x;
+        }
+        if (i % 5000 == 0) CHECK(acc.value() == expect);
+    }
+    CHECK(acc.value() == expect);
+    CHECK(acc.toString() == expect.toString());
+    acc -= expect;
+    CHECK(acc.value() == 0);
+    acc.clear();
+    BigInteger big("-1" + std::string(50, '0'));
+    BigAccumulator init(big);
+    // More adds than the column headroom, so normalize runs mid-stream.
+    for (int i = 0; i < 70000; i++) init += BigInteger(32767);
+    CHECK(init.value() == big + BigInteger(32767) * 70000);
+}
+
+static void test_unreduced_rational() {
+    UnreducedRational h = 0;
+    Rational expect = 0;
+    for (int i = 1; i <= 200; i++) {
+        h += UnreducedRational(Rational(BigInteger(1), BigInteger(i)));
+        expect += Rational(BigInteger(1), BigInteger(i));
+    }
+    CHECK(h.toString() == expect.toString());
+    CHECK(h.asDecimal(20) == expect.asDecimal(20));
+    CHECK(h == UnreducedRational(expect));
+    CHECK((double)h == (double)expect);
+
+    UnreducedRational q = UnreducedRational(6) / UnreducedRational(-4);
+    q *= UnreducedRational(Rational(BigInteger(2), BigInteger(3)));
+    q -= UnreducedRational(1);
+    CHECK(q.reduced() == Rational(BigInteger(-2)));
+    CHECK(q < UnreducedRational(0) && UnreducedRational(-3) <= q && q != UnreducedRational(2));
+
+    // Const readers do not modify the value, so they may run concurrently.
+    UnreducedRational a = UnreducedRational(Rational(BigInteger(1), BigInteger(6))) + UnreducedRational(Rational(BigInteger(1), BigInteger(3)));
+    const UnreducedRational &shared = a;
+    std::vector<std::string> seen(4);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&shared, &seen, t]() {
+            seen[t] = shared.toString();
+        });
+    }
+    for (size_t t = 0; t < readers.size(); t++) readers[t].join();
+    for (int t = 0; t < 4; t++) CHECK(seen[t] == "1/2");
+}
+
+static std::string temp_file(const char *contents) {
+    char path[] = "/tmp/test_bigintXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return "";
+    CHECK(write(fd, contents, strlen(contents)) == (ssize_t)strlen(contents));
+    ::close(fd);
+    return path;
+}
+
+static void test_thresholds() {
+    BigIntegerThresholds saved = BigInteger::thresholds();
+    std::mt19937_64 rng(42);
+    for (int i = 0; i < 40; i++) {
+        BigInteger a = random_big(rng, 400), b = random_big(rng, i % 2 ? 400 : 30);
+        BigInteger::thresholds().mul_karatsuba = BigInteger::thresholds().sqr_karatsuba = 1 << 30;
+        BigInteger plain = a * b, plain_sqr = a * a;
+        BigInteger::thresholds().mul_karatsuba = BigInteger::thresholds().sqr_karatsuba = 2;
+        CHECK(a * b == plain);
+        CHECK(a * a == plain_sqr);
+    }
+    BigInteger::thresholds() = saved;
+
+    std::string good = temp_file("mul_karatsuba 17\nunknown 5\nsqr_karatsuba 23\n");
+    CHECK(BigInteger::load_thresholds(good.c_str()));
+    CHECK(BigInteger::thresholds().mul_karatsuba == 17 && BigInteger::thresholds().sqr_karatsuba == 23);
+    CHECK(BigInteger::save_thresholds(good.c_str()));
+    BigInteger::thresholds() = saved;
+    CHECK(BigInteger::load_thresholds(good.c_str()));
+    CHECK(BigInteger::thresholds().mul_karatsuba == 17 && BigInteger::thresholds().sqr_karatsuba == 23);
+    BigInteger::thresholds() = saved;
+    std::string zero = temp_file("mul_karatsuba 0\n"), junk = temp_file("mul_karatsuba 9\nsqr_karatsuba x\n");
+    CHECK(!BigInteger::load_thresholds(zero.c_str()));
+    CHECK(!BigInteger::load_thresholds(junk.c_str()));
+    CHECK(!BigInteger::load_thresholds("/nonexistent/thresholds.txt"));
+    CHECK(BigInteger::thresholds().mul_karatsuba == saved.mul_karatsuba);
+    unlink(good.c_str());
+    unlink(zero.c_str());
+    unlink(junk.c_str());
+}
+
+#ifdef BIGINT_STATS
+static unsigned long long stat_total(const BigIntegerStatsBlock &s, BigIntegerStat op) {
+    unsigned long long total = 0;
+    for (size_t b = 0; b < STAT_BUCKETS; b++) total += s.count[op][b];
+    return total;
+}
+
+static void test_stats() {
+    std::mt19937_64 rng(43);
+    BigInteger a = random_big(rng, 1) + BigInteger("1" + std::string(1500, '0'));
+    BigInteger b = BigInteger("7" + std::string(600, '3'));
+    BigIntegerStats::reset();
+    BigInteger p = a * b;
+    BigInteger q = p / b;
+    BigIntegerStatsBlock s = BigIntegerStats::snapshot();
+    CHECK(q == a);
+    CHECK(stat_total(s, STAT_MUL) >= 1);
+    CHECK(stat_total(s, STAT_MUL_KARATSUBA) >= 1 && stat_total(s, STAT_MUL_BASECASE) >= 1);
+    CHECK(stat_total(s, STAT_DIV) >= 1);
+    CHECK(stat_total(s, STAT_ALLOC) >= 1 && s.alloc_bytes > 0);
+    // 600 decimal digits take 133 limbs: bucket floor(log2(133)) + 1.
+    CHECK(s.count[STAT_DIV][8] >= 1);
+    std::string json = BigIntegerStats::to_json(s);
+    CHECK(json.find("\"mul\": {\"count\": ") != std::string::npos);
+    CHECK(json.find("\"reduce\"") == std::string::npos);
+
+    // A finished thread's counts stay in the totals.
+    BigIntegerStats::reset();
+    std::thread worker([&]() {
+        Rational r(a, b);
+        r += Rational(b, a);
+    });
+    worker.join();
+    s = BigIntegerStats::snapshot();
+    CHECK(stat_total(s, STAT_REDUCE) >= 1 && stat_total(s, STAT_GCD_STEP) >= 1);
+    BigIntegerStats::reset();
+    CHECK(stat_total(BigIntegerStats::snapshot(), STAT_REDUCE) == 0);
+}
+#endif
+
+#ifdef BIGINT_MEMORY_STATS
+static void test_memory_stats() {
+    BigIntegerMemoryStats before = BigIntegerMemory::snapshot();
+    BigIntegerMemory::reset();
+    {
+        std::vector<BigInteger> values;
+        for (int i = 0; i < 10; i++) values.push_back(BigInteger("9" + std::string(300, '1')));
+        BigInteger small(12345);
+        BigIntegerMemoryStats s = BigIntegerMemory::snapshot();
+        CHECK(s.live_buffers == before.live_buffers + 10);
+        CHECK(s.live_limbs >= before.live_limbs + 10 * 67);
+        CHECK(s.peak_bytes >= s.live_bytes);
+        CHECK(s.histogram[MEMORY_PARSE][7] >= 10);
+        BigInteger p = values[0] * values[1];
+        s = BigIntegerMemory::snapshot();
+        unsigned long long mul = 0, rational = 0;
+        for (size_t b = 0; b < MEMORY_BUCKETS; b++) mul += s.histogram[MEMORY_MUL][b];
+        CHECK(mul >= 1);
+        Rational r(values[0], p);
+        r *= Rational(values[2], values[3]);
+        s = BigIntegerMemory::snapshot();
+        for (size_t b = 0; b < MEMORY_BUCKETS; b++) rational += s.histogram[MEMORY_RATIONAL][b];
+        CHECK(rational >= 1);
+        std::string json = BigIntegerMemory::to_json(s);
+        CHECK(json.find("\"peak_bytes\": ") != std::string::npos && json.find("\"rational\": {") != std::string::npos);
+    }
+    BigIntegerMemoryStats after = BigIntegerMemory::snapshot();
+    CHECK(after.live_buffers == before.live_buffers && after.live_bytes == before.live_bytes);
+    CHECK(after.peak_bytes > after.live_bytes);
+}
+#endif
+
+#ifdef BN_MEMORY_STATS
+static void test_bn_memory_stats() {
+    struct bn_memory_stats before, s;
+    bn_memory_stats(&before);
+    bn *t = bn_new(), *u = bn_new();
+    bn_memory_stats(&s);
+    // Only the two one-limb bodies, not the struct bn_s headers.
+    CHECK(s.live_blocks == before.live_blocks + 2);
+    CHECK(s.live_bytes == before.live_bytes + 2 * sizeof(int));
+    std::string x = "1" + std::string(200, '0'), y = "3" + std::string(100, '7');
+    bn_init_string(t, x.c_str());
+    bn_init_string(u, y.c_str());
+    bn_memory_reset_peak();
+    bn_mul_to(t, u);
+    bn_memory_stats(&s);
+    CHECK(s.peak_bytes >= s.live_bytes && s.live_blocks == before.live_blocks + 2);
+    bn_delete(t);
+    bn_delete(u);
+    bn_memory_stats(&s);
+    CHECK(s.live_blocks == before.live_blocks && s.live_bytes == before.live_bytes);
+}
+#endif
+
+static void test_workspace() {
+    std::mt19937_64 rng(45);
+    BigIntegerWorkspace ws;
+    std::vector<BigInteger> a, b;
+    for (int i = 0; i < 200; i++) {
+        a.push_back(random_big(rng, i % 10 == 0 ? 300 : 40));
+        b.push_back(random_big(rng, i % 7 == 0 ? 150 : 20));
+        if (b.back().is_zero()) b.back() = 3;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        BigInteger p = a[i], q = a[i], r, quot, rem, trunc = a[i], mod = a[i], g = a[i], sq = a[i];
+        p.mul(b[i], ws);
+        CHECK(p == a[i] * b[i]);
+        sq.mul(sq, ws);
+        CHECK(sq == a[i] * a[i]);
+        q.div(b[i], r, ws);
+        CHECK(q == a[i] / b[i] && r == a[i] % b[i]);
+        a[i].divmod(b[i], quot, rem, ws);
+        CHECK(quot == q && rem == r);
+        trunc.quotient(b[i], ws);
+        mod.remainder(b[i], ws);
+        CHECK(trunc == q && mod == r);
+        g.gcd(b[i], ws);
+        CHECK(g > 0 && (a[i] % g).is_zero() && (b[i] % g).is_zero());
+        BigInteger ga = a[i] / g, gb = b[i] / g;
+        ga.gcd(gb);
+        CHECK(ga == 1);
+    }
+    CHECK(ws.capacity() > 0);
+
+    // Targets reserved up front and a workspace that has already seen the
+    // largest operands leave the second pass allocation-free.
+    BigInteger p, q, r, g;
+    p.reserve(700), q.reserve(700), r.reserve(700), g.reserve(700);
+    CHECK(p.capacity() >= 700);
+    for (int round = 0; round < 2; round++) {
+        size_t before = allocations;
+        for (size_t i = 0; i < a.size(); i++) {
+            p = a[i];
+            p.mul(b[i], ws);
+            q = a[i];
+            q.div(b[i], r, ws);
+            g = a[i];
+            g.gcd(b[i], ws);
+        }
+        if (round == 1) CHECK(allocations == before);
+    }
+    CHECK(p == a.back() * b.back() && q == a.back() / b.back() && r == a.back() % b.back());
+
+    ws.clear();
+    CHECK(ws.capacity() == 0);
+    p.shrink_to_fit();
+    CHECK(p.capacity() < 700);
+
+    // Rational arithmetic reduces through the same workspace path.
+    BigInteger big = a[0] * a[0] + 1;
+    Rational x(BigInteger(6) * big, BigInteger(4) * big);
+    CHECK(x == Rational(BigInteger(3), BigInteger(2)));
+}
+
+static void test_divexact() {
+    std::mt19937_64 rng(46);
+    BigIntegerWorkspace ws;
+    for (int i = 0; i < 500; i++) {
+        BigInteger q = random_big(rng, i % 5 == 0 ? 200 : 30), d = random_big(rng, i % 3 == 0 ? 120 : 6);
+        if (d.is_zero()) d = -1;
+        // Shifted divisors exercise the stripped trailing zero limbs.
+        if (i % 4 == 0) d <<= rng() % 70;
+        BigInteger n = q * d, exact = n, same = n;
+        exact.divexact(d);
+        same.divexact(d, ws);
+        CHECK(exact == q && same == q);
+        CHECK(n.divisible_by(d) && n.divisible_by(d, ws));
+        BigInteger off = n + 1;
+        if (d != 1 && d != -1) CHECK(!off.divisible_by(d) && !off.divisible_by(d, ws));
+        BigInteger r = random_big(rng, 200);
+        CHECK(r.divisible_by(d) == (r % d).is_zero());
+    }
+    BigInteger zero = 0, seven = 7;
+    CHECK(zero.divisible_by(zero) && !seven.divisible_by(zero) && zero.divisible_by(seven));
+    bool threw = false;
+    try {
+        seven.divexact(zero);
+    } catch (const std::domain_error &) {
+        threw = true;
+    }
+    CHECK(threw);
+    BigInteger big("-" + std::string(80, '9'));
+    big.divexact(BigInteger(std::string(40, '9')));
+    CHECK(big == BigInteger("-1" + std::string(39, '0') + "1"));
+}
+
+static BigInteger magnitude(BigInteger x) {
+    x.abs();
+    return x;
+}
+
+static void test_divmod() {
+    // Quotients truncate toward zero and remainders take the sign of the
+    // dividend, as for long long.
+    const long long pairs[][2] = {{17, 5}, {-17, 5}, {17, -5}, {-17, -5}, {4, 7}, {-4, 7}, {0, -3}, {-15, 5}};
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        long long x = pairs[i][0], y = pairs[i][1];
+        BigInteger quot, rem;
+        BigInteger(x).divmod(BigInteger(y), quot, rem);
+        CHECK(quot == x / y && rem == x % y);
+        BigInteger scale("1" + std::string(40, '0'));
+        BigInteger a = BigInteger(x) * scale + BigInteger(x < 0 ? -3 : 3), b = BigInteger(y) * scale;
+        a.divmod(b, quot, rem);
+        CHECK(quot * b + rem == a && magnitude(rem) < magnitude(b));
+        CHECK(rem.is_zero() || (rem < 0) == (a < 0));
+        CHECK(quot == a / b && rem == a % b);
+    }
+
+    std::mt19937_64 rng(47);
+    BigIntegerWorkspace ws;
+    for (int i = 0; i < 300; i++) {
+        BigInteger a = random_big(rng, 120), b = random_big(rng, i % 2 ? 60 : 3);
+        if (b.is_zero()) b = 1;
+        BigInteger quot, rem, q = a, r = a, d = b;
+        a.divmod(b, quot, rem, ws);
+        CHECK(quot * b + rem == a && magnitude(rem) < magnitude(b));
+        // Outputs aliasing the dividend or the divisor see the original
+        // operands.
+        q.divmod(b, q, rem);
+        CHECK(q == quot);
+        r.divmod(b, quot, r);
+        CHECK(r == rem);
+        a.divmod(d, quot, d);
+        CHECK(d == rem);
+        q = a;
+        q.quotient(b, ws);
+        r = a;
+        r.remainder(b, ws);
+        CHECK(q == quot && r == rem);
+    }
+
+    BigInteger quot, rem;
+    bool threw = false;
+    try {
+        BigInteger(1).divmod(BigInteger(0), quot, rem);
+    } catch (const std::domain_error &) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+static void test_word_operands() {
+    std::mt19937_64 rng(48);
+    for (int i = 0; i < 500; i++) {
+        BigInteger a = random_big(rng, i % 3 ? 4 : 40);
+        long long s = (long long)rng() >> (rng() % 64);
+        if (s == 0) s = -5;
+        unsigned long long u = rng() >> (rng() % 64) | 1;
+        int small = (int)(rng() % 65536) - 32768;
+        if (small == 0) small = 1;
+        BigInteger bs(s), bu(u), bsmall(small);
+        CHECK(a + s == a + bs && s + a == bs + a && a - s == a - bs && s - a == bs - a);
+        CHECK(a * s == a * bs && s * a == bs * a && a / s == a / bs && a % s == a % bs);
+        CHECK(a + u == a + bu && a - u == a - bu && a * u == a * bu && a / u == a / bu && a % u == a % bu);
+        CHECK(a * small == a * bsmall && a / small == a / bsmall && a % small == a % bsmall);
+        CHECK((a == s) == (a == bs) && (a != s) == (a != bs) && (a < s) == (a < bs));
+        CHECK((a > u) == (a > bu) && (a <= u) == (a <= bu) && (a >= small) == (a >= bsmall));
+        CHECK((s < a) == (bs < a) && (u == a) == (bu == a) && (small >= a) == (bsmall >= a));
+        BigInteger c = a;
+        c += (short)-7;
+        c -= (unsigned char)200;
+        c *= 3U;
+        CHECK(c == (a - 207) * 3);
+    }
+    BigInteger min(LLONG_MIN);
+    CHECK(min == LLONG_MIN && min - 1 < LLONG_MIN && -min == (unsigned long long)LLONG_MAX + 1);
+    CHECK(BigInteger(ULLONG_MAX) * ULLONG_MAX == BigInteger(ULLONG_MAX) * BigInteger(ULLONG_MAX));
+    CHECK(BigInteger(7) / -2 == -3 && BigInteger(-7) % 2 == -1);
+
+    // bool operands convert like any other value instead of taking the word
+    // overloads.
+    BigInteger one(1);
+    BigInteger flag(0);
+    flag += true;
+    CHECK(flag == true && flag == one && flag - true == false);
+}
+
+static void test_bit_operations() {
+    std::mt19937_64 rng(49);
+    // Operands that fit in 48 bits are checked against long long, whose
+    // operators work on the same two's complement form.
+    for (int i = 0; i < 2000; i++) {
+        long long x = (long long)(rng() >> 16) - (1LL << 47), y = (long long)(rng() >> (16 + rng() % 40)) - (1LL << 20);
+        size_t k = rng() % 15, r = rng() % 60;
+        BigInteger a(x), b(y);
+        CHECK((a & b) == (x & y) && (a | b) == (x | y) && (a ^ b) == (x ^ y) && ~a == ~x);
+        CHECK((a << k) == x * (1LL << k) && (a >> r) == x >> r);
+        BigInteger c = a;
+        c &= b;
+        c |= a << 3;
+        c ^= ~b;
+        CHECK(c == (((x & y) | x * 8) ^ ~y));
+        for (size_t n = 0; n < 64; n += 7) CHECK(a.test_bit(n) == ((x >> n) & 1));
+        unsigned long long m = x < 0 ? 0ULL - (unsigned long long)x : (unsigned long long)x;
+        CHECK(a.popcount() == (size_t)__builtin_popcountll(m));
+        CHECK(a.bit_length() == (m ? 64 - (size_t)__builtin_clzll(m) : 0));
+        CHECK(a.ctz() == (m ? (size_t)__builtin_ctzll(m) : 0));
+        size_t n = rng() % 50;
+        bool value = rng() & 1;
+        BigInteger d = a;
+        d.set_bit(n, value);
+        CHECK(d == (value ? x | (1LL << n) : x & ~(1LL << n)));
+    }
+
+    // Larger operands are checked through identities of two's complement.
+    for (int i = 0; i < 300; i++) {
+        BigInteger a = random_big(rng, 40), b = random_big(rng, 40);
+        size_t k = rng() % 200;
+        CHECK((a & b) + (a | b) == a + b);
+        CHECK((a ^ b) == (a | b) - (a & b));
+        CHECK(~a == -a - 1 && ~~a == a);
+        CHECK((a << k) >> k == a);
+        BigInteger power = 1;
+        power <<= k;
+        CHECK((a << k) == a * power);
+        BigInteger floor = a / power;
+        if (a < 0 && !(a % power).is_zero()) floor -= 1;
+        CHECK((a >> k) == floor);
+        CHECK(a.test_bit(k) == !((a >> k) % 2).is_zero());
+        BigInteger magnitude = a < 0 ? -a : a;
+        size_t count = 0;
+        for (size_t n = 0; n < magnitude.bit_length(); n++) count += magnitude.test_bit(n);
+        CHECK(a.popcount() == count);
+        CHECK(a.is_zero() || (a.bit_length() > 0 && !(magnitude >> (a.bit_length() - 1)).is_zero() && (magnitude >> a.bit_length()).is_zero()));
+        CHECK(a.is_zero() || (magnitude.test_bit(a.ctz()) && (magnitude >> a.ctz() << a.ctz()) == magnitude));
+    }
+    BigInteger zero = 0;
+    CHECK(zero.bit_length() == 0 && zero.popcount() == 0 && zero.ctz() == 0 && (zero >> 5) == 0 && ~zero == -1);
+    BigInteger minus_one = -1;
+    CHECK((minus_one >> 100) == -1 && minus_one.test_bit(1000) && (minus_one & BigInteger(12345)) == 12345);
+}
+
+static void test_rational_batch() {
+    std::mt19937_64 rng(50);
+    const size_t count = 1000;
+    std::vector<Rational> a, b;
+    for (size_t i = 0; i < count; i++) {
+        BigInteger d = random_big(rng, i % 50 ? 4 : 30), e = random_big(rng, 4);
+        if (d.is_zero()) d = 3;
+        if (e.is_zero()) e = -2;
+        a.push_back(Rational(random_big(rng, i % 50 ? 4 : 30), d));
+        b.push_back(Rational(random_big(rng, 4) + 1, e));
+    }
+    for (unsigned int threads = 1; threads <= 4; threads += 3) {
+        std::vector<Rational> sum(count), product(count), quotient(count);
+        RationalBatch::add(sum.data(), a.data(), b.data(), count, threads);
+        RationalBatch::mul(product.data(), a.data(), b.data(), count, threads);
+        RationalBatch::div(quotient.data(), a.data(), b.data(), count, threads);
+        for (size_t i = 0; i < count; i++) {
+            CHECK(sum[i] == a[i] + b[i] && sum[i].toString() == (a[i] + b[i]).toString());
+            CHECK(product[i] == a[i] * b[i] && quotient[i] == a[i] / b[i]);
+        }
+
+        // out may be either operand.
+        std::vector<Rational> x = a, y = b;
+        RationalBatch::add(x.data(), x.data(), b.data(), count, threads);
+        RationalBatch::mul(y.data(), a.data(), y.data(), count, threads);
+        for (size_t i = 0; i < count; i++) CHECK(x[i] == sum[i] && y[i] == product[i]);
+        std::vector<Rational> z = a;
+        RationalBatch::mul(z.data(), z.data(), z.data(), count, threads);
+        for (size_t i = 0; i < count; i++) CHECK(z[i] == a[i] * a[i]);
+        RationalBatch::reduce(z.data(), count, threads);
+        for (size_t i = 0; i < count; i++) CHECK(z[i].toString() == (a[i] * a[i]).toString());
+
+        Rational total = 0, all = 1;
+        for (size_t i = 0; i < 120; i++) total += b[i];
+        for (size_t i = 0; i < 120; i++) all *= b[i];
+        CHECK(RationalBatch::sum(b.data(), 120, threads) == total);
+        CHECK(RationalBatch::product(b.data(), 120, threads) == all);
+        CHECK(RationalBatch::sum(a.data(), 1, threads) == a[0]);
+    }
+    CHECK(RationalBatch::sum(a.data(), 0) == 0 && RationalBatch::product(a.data(), 0) == 1);
+    RationalBatch::add(NULL, NULL, NULL, 0, 4);
+}
+
+int main() {
+    test_stream_format();
+    test_bn_radix_leading_zero_limbs();
+    test_bn_int_leading_zero_limbs();
+    test_lazy_expressions();
+    test_remainder_aliasing();
+    test_serialization();
+    test_bn_pow_negative();
+    test_views();
+    test_mapped();
+    test_mapped_count();
+    test_pow();
+    test_bn_radix_round_trip();
+    test_bn_serialize_leading_zero_limbs();
+    test_import_export();
+    test_reader_writer();
+    test_rational_to_double();
+    test_construct_exact();
+    test_decimal_expansion();
+    test_inline_limbs();
+#if __cplusplus >= 201402L
+    test_fixed_width();
+#endif
+#if __cplusplus >= 201402L
+    test_literals();
+#endif
+    test_fused_multiply();
+    test_accumulator();
+    test_unreduced_rational();
+    test_thresholds();
+#ifdef BIGINT_STATS
+    test_stats();
+#endif
+#ifdef BIGINT_MEMORY_STATS
+    test_memory_stats();
+#endif
+#ifdef BN_MEMORY_STATS
+    test_bn_memory_stats();
+#endif
+    test_workspace();
+    test_divexact();
+    test_divmod();
+    test_word_operands();
+    test_bit_operations();
+    test_rational_batch();
+    if (failures) fprintf(stderr, "%d checks failed\n", failures);
+    else printf("all tests passed\n");
+    return failures ? 1 : 0;
+}